@@ -0,0 +1,131 @@
+package com.benjaminwan.ocrlibrary
+
+import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.Paint
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.After
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.util.Collections
+import java.util.concurrent.atomic.AtomicLong
+import kotlin.concurrent.thread
+
+/**
+ * detect并发测试: 多个线程共用一个OcrEngine(2个box workers、开启识别缓存)，轮流调用detect、detectFlat、
+ * detectAsync+detectAsyncGet和detectProgressive，每个结果须与单线程的参考结果一致，且不抛出异常。
+ * 需要把模型放到OcrLibrary/src/main/assets
+ */
+@RunWith(AndroidJUnit4::class)
+class OcrDetectStressTest {
+    private lateinit var ocrEngine: OcrEngine
+    private lateinit var inputs: List<Bitmap>
+
+    //调用方看到的内容: 各文本框的坐标、方向与文本
+    private data class Line(val boxPoint: List<Point>, val angleIndex: Int, val text: String)
+
+    private enum class Mode { DETECT, FLAT, ASYNC, PROGRESSIVE }
+
+    private fun render(vararg lines: String): Bitmap {
+        val bitmap = Bitmap.createBitmap(520, 48 + 56 * lines.size, Bitmap.Config.ARGB_8888)
+        val canvas = Canvas(bitmap)
+        canvas.drawColor(Color.WHITE)
+        val paint = Paint(Paint.ANTI_ALIAS_FLAG).apply {
+            color = Color.BLACK
+            textSize = 36f
+        }
+        lines.forEachIndexed { i, line -> canvas.drawText(line, 16f, 64f + 56 * i, paint) }
+        return bitmap
+    }
+
+    @Before
+    fun setUp() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        ocrEngine = OcrEngine(context, boxWorkers = 2)
+        ocrEngine.recCacheSize = 64
+        inputs = listOf(
+            render("shared engine 0123", "INVOICE 2024-0117"),
+            render("Serial No. A7X-552", "Lot 0042", "stress 9876543210")
+        )
+    }
+
+    @After
+    fun tearDown() {
+        ocrEngine.release()
+    }
+
+    private fun toLines(result: OcrResult): List<Line> {
+        assertTrue("partial result", !result.partial)
+        return result.textBlocks.map { Line(it.boxPoint.toList(), it.angleIndex, it.text) }
+    }
+
+    private fun run(input: Bitmap, mode: Mode): List<Line> {
+        val output = input.copy(Bitmap.Config.ARGB_8888, true)
+        return when (mode) {
+            Mode.DETECT -> toLines(ocrEngine.detect(input, output, 1024))
+            Mode.FLAT -> toLines(ocrEngine.detectFlat(input, output, 1024).toOcrResult())
+            Mode.ASYNC -> {
+                val handle = ocrEngine.detectAsync(input, 1024)
+                toLines(ocrEngine.detectAsyncGet(handle, output) ?: throw AssertionError("async task cancelled"))
+            }
+            Mode.PROGRESSIVE -> {
+                var boxes = ArrayList<TextBox>()
+                val blocks = ArrayList<Pair<Int, TextBlock>>()
+                val result = ocrEngine.detectProgressive(input, output, 1024, object : OcrListener {
+                    override fun onTextBoxes(textBoxes: ArrayList<TextBox>) {
+                        boxes = textBoxes
+                    }
+
+                    override fun onTextBlock(index: Int, textBlock: TextBlock) {
+                        blocks.add(index to textBlock)
+                    }
+                })
+                //每个文本框恰好回调一次，文本与最终结果相同
+                assertEquals(result.textBlocks.size, blocks.size)
+                assertEquals(blocks.size, blocks.map { it.first }.toSet().size)
+                blocks.forEach { (index, block) ->
+                    assertEquals(boxes[index].boxPoint, block.boxPoint)
+                    assertEquals(result.textBlocks[index].text, block.text)
+                }
+                toLines(result)
+            }
+        }
+    }
+
+    @Test
+    fun concurrentDetectMatchesReference() {
+        //各路径的单线程参考结果，之后的调用可能命中识别缓存
+        val references = inputs.map { input -> Mode.values().associateWith { run(input, it) } }
+        references.forEach { byMode -> byMode.values.forEach { assertTrue(it.isNotEmpty()) } }
+
+        val calls = AtomicLong(0)
+        val failures = Collections.synchronizedList(ArrayList<String>())
+        val workers = List(4) { t ->
+            thread {
+                for (n in 0 until 20) {
+                    //相邻线程同一时刻使用不同的图片和路径
+                    val image = (t + n) % inputs.size
+                    val mode = Mode.values()[(t + n / inputs.size) % Mode.values().size]
+                    try {
+                        val lines = run(inputs[image], mode)
+                        if (lines != references[image][mode]) {
+                            failures.add("thread $t call $n image $image $mode: $lines")
+                        }
+                    } catch (e: Throwable) {
+                        failures.add("thread $t call $n image $image $mode: $e")
+                    }
+                    calls.incrementAndGet()
+                }
+            }
+        }
+        workers.forEach { it.join() }
+
+        assertEquals(emptyList<String>(), failures.toList())
+        assertEquals(4L * 20, calls.get())
+    }
+}
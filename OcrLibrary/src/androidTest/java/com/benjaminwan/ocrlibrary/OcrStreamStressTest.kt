@@ -0,0 +1,98 @@
+package com.benjaminwan.ocrlibrary
+
+import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.Paint
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.After
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicLong
+import kotlin.concurrent.thread
+import kotlin.random.Random
+
+/**
+ * 流式识别并发测试: 多个线程streamPush/streamPop的同时反复streamStart/streamFinish/streamStop，
+ * 不应崩溃，也不应取到残缺的结果。需要把模型放到OcrLibrary/src/main/assets
+ */
+@RunWith(AndroidJUnit4::class)
+class OcrStreamStressTest {
+    private lateinit var ocrEngine: OcrEngine
+    private lateinit var input: Bitmap
+
+    @Before
+    fun setUp() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        ocrEngine = OcrEngine(context)
+        input = Bitmap.createBitmap(420, 64, Bitmap.Config.ARGB_8888)
+        val canvas = Canvas(input)
+        canvas.drawColor(Color.WHITE)
+        val paint = Paint(Paint.ANTI_ALIAS_FLAG).apply {
+            color = Color.BLACK
+            textSize = 36f
+        }
+        canvas.drawText("stream 0123456789", 16f, 46f, paint)
+    }
+
+    @After
+    fun tearDown() {
+        ocrEngine.streamStop()
+        ocrEngine.release()
+    }
+
+    @Test
+    fun pushPopWhileRestarting() {
+        val running = AtomicBoolean(true)
+        val popped = AtomicLong(0)
+        val bad = AtomicLong(0)
+        val workers = List(2) {
+            thread {
+                while (running.get()) {
+                    if (ocrEngine.streamPush(input, 1024, false) < 0) Thread.yield()
+                }
+            }
+        } + List(2) {
+            thread {
+                while (running.get()) {
+                    val result = ocrEngine.streamPop(null)
+                    if (result == null) {
+                        Thread.yield()
+                        continue
+                    }
+                    popped.incrementAndGet()
+                    //停止时只丢弃帧，不会返回残缺的结果
+                    if (result.partial || result.textBlocks.isEmpty()) bad.incrementAndGet()
+                }
+            }
+        } + thread {
+            while (running.get()) {
+                ocrEngine.streamStats()
+                Thread.sleep(1)
+            }
+        }
+
+        val random = Random(7)
+        val end = System.currentTimeMillis() + 10_000
+        while (System.currentTimeMillis() < end) {
+            ocrEngine.streamStart(2)
+            Thread.sleep(random.nextLong(200))
+            if (random.nextBoolean()) {
+                ocrEngine.streamFinish()
+                Thread.sleep(random.nextLong(50))
+            }
+            if (random.nextInt(4) != 0) ocrEngine.streamStop()
+        }
+        ocrEngine.streamStop()
+        running.set(false)
+        workers.forEach { it.join() }
+
+        assertTrue(popped.get() > 0)
+        assertEquals(0, bad.get())
+    }
+}
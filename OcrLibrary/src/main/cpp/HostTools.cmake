@@ -0,0 +1,87 @@
+# Host (Linux) build of the JNI-free sources plus the benchmark tools
+# cmake -S . -B build-host -DONNXRUNTIME_DIR=<onnxruntime dir> [-DOpenCV_DIR=<opencv cmake dir>]
+set(CMAKE_CXX_STANDARD 14)
+if (NOT CMAKE_BUILD_TYPE)
+    set(CMAKE_BUILD_TYPE Release)
+endif ()
+
+## opencv 库
+find_package(OpenCV REQUIRED core imgproc imgcodecs)
+message(STATUS "OpenCV_LIBS: ${OpenCV_LIBS}")
+
+# OnnxRuntime: the RapidAI packages keep the source include layout, the official ones are flat
+set(ONNXRUNTIME_DIR "" CACHE PATH "onnxruntime package with include and lib")
+find_library(OnnxRuntime_LIBS onnxruntime PATHS ${ONNXRUNTIME_DIR}/lib NO_DEFAULT_PATH)
+find_library(OnnxRuntime_LIBS onnxruntime)
+if (NOT OnnxRuntime_LIBS)
+    message(FATAL_ERROR "onnxruntime Not Found! set ONNXRUNTIME_DIR")
+endif ()
+find_path(OnnxRuntime_INCLUDE_DIRS onnxruntime/core/session/onnxruntime_cxx_api.h
+        PATHS ${ONNXRUNTIME_DIR}/include NO_DEFAULT_PATH)
+if (NOT OnnxRuntime_INCLUDE_DIRS)
+    find_path(OnnxRuntime_FLAT_INCLUDE onnxruntime_cxx_api.h
+            PATHS ${ONNXRUNTIME_DIR}/include PATH_SUFFIXES onnxruntime/core/session onnxruntime
+            NO_DEFAULT_PATH)
+    if (NOT OnnxRuntime_FLAT_INCLUDE)
+        message(FATAL_ERROR "onnxruntime_cxx_api.h Not Found! set ONNXRUNTIME_DIR")
+    endif ()
+    # forward the include path the sources use to the flat headers
+    set(OnnxRuntime_INCLUDE_DIRS ${CMAKE_CURRENT_BINARY_DIR}/ort-include ${OnnxRuntime_FLAT_INCLUDE})
+    file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/ort-include/onnxruntime/core/session/onnxruntime_cxx_api.h
+            "#include \"${OnnxRuntime_FLAT_INCLUDE}/onnxruntime_cxx_api.h\"\n")
+endif ()
+message(STATUS "OnnxRuntime_LIBS: ${OnnxRuntime_LIBS}")
+message(STATUS "OnnxRuntime_INCLUDE_DIRS: ${OnnxRuntime_INCLUDE_DIRS}")
+
+find_package(Threads REQUIRED)
+find_package(OpenMP)
+
+# everything but the JNI glue
+file(GLOB OCR_SRC src/*.cpp)
+list(REMOVE_ITEM OCR_SRC
+        ${CMAKE_CURRENT_SOURCE_DIR}/src/main.cpp
+        ${CMAKE_CURRENT_SOURCE_DIR}/src/BitmapUtils.cpp
+        ${CMAKE_CURRENT_SOURCE_DIR}/src/OcrResultUtils.cpp)
+
+add_library(RapidOcrHost STATIC ${OCR_SRC})
+target_include_directories(RapidOcrHost PUBLIC include ${OnnxRuntime_INCLUDE_DIRS} ${OpenCV_INCLUDE_DIRS})
+target_link_libraries(RapidOcrHost PUBLIC ${OnnxRuntime_LIBS} ${OpenCV_LIBS} Threads::Threads)
+if (OpenMP_CXX_FOUND)
+    target_link_libraries(RapidOcrHost PUBLIC OpenMP::OpenMP_CXX)
+endif ()
+
+add_executable(ocr_benchmark tools/benchmark.cpp tools/ToolUtils.cpp)
+target_link_libraries(ocr_benchmark RapidOcrHost)
+
+add_executable(ocr_regression tools/regression.cpp tools/ToolUtils.cpp)
+target_link_libraries(ocr_regression RapidOcrHost)
+
+add_executable(ocr_stream_stress tools/stream_stress.cpp tools/ToolUtils.cpp)
+target_link_libraries(ocr_stream_stress RapidOcrHost)
+
+add_executable(ocr_detect_stress tools/detect_stress.cpp tools/ToolUtils.cpp)
+target_link_libraries(ocr_detect_stress RapidOcrHost)
+
+# ctest runs the regression suite and the stress tests when the models are given, the latency check needs a baseline
+# made on the same machine: ocr_regression --update-baseline
+set(OCR_MODELS_DIR "" CACHE PATH "models for the ocr_regression test")
+set(OCR_BASELINE "" CACHE FILEPATH "latency baseline for the ocr_regression test")
+if (OCR_MODELS_DIR)
+    enable_testing()
+    set(OCR_REGRESSION_ARGS --models ${OCR_MODELS_DIR} --data ${CMAKE_CURRENT_SOURCE_DIR}/tools/regression)
+    if (OCR_BASELINE)
+        list(APPEND OCR_REGRESSION_ARGS --baseline ${OCR_BASELINE})
+    endif ()
+    add_test(NAME ocr_regression COMMAND ocr_regression ${OCR_REGRESSION_ARGS})
+    add_test(NAME ocr_stream_stress COMMAND ocr_stream_stress --models ${OCR_MODELS_DIR} --seconds 5)
+    add_test(NAME ocr_detect_stress COMMAND ocr_detect_stress --models ${OCR_MODELS_DIR})
+endif ()
+
+# microbenchmarks of the utility hot spots, built when google benchmark is installed
+find_package(benchmark QUIET)
+if (benchmark_FOUND)
+    add_executable(ocr_microbench tools/microbench.cpp)
+    target_link_libraries(ocr_microbench RapidOcrHost benchmark::benchmark)
+else ()
+    message(STATUS "google benchmark Not Found, skip ocr_microbench")
+endif ()
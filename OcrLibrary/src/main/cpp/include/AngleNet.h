@@ -2,10 +2,12 @@
 #define __OCR_ANGLENET_H__
 
 #include "OcrStruct.h"
+#include "CancelToken.h"
+#include "Workspace.h"
+#include "OrtProfiler.h"
 #include "onnxruntime/core/session/onnxruntime_cxx_api.h"
 #include <opencv2/core.hpp>
-#include <android/asset_manager.h>
-#include <android/asset_manager_jni.h>
+#include "OcrUtils.h"
 
 class AngleNet {
 public:
@@ -17,13 +19,23 @@ public:
 
     void initModel(AAssetManager *mgr, const std::string &name);
 
-    std::vector<Angle> getAngles(std::vector<cv::Mat> &partImgs, bool doAngle, bool mostAngle);
+    //profile the next runs, see OrtProfiler
+    bool startProfiling(const std::string &prefix, int runs);
+
+    std::vector<OpProfile> getOpProfiles();
+
+    std::vector<Angle> getAngles(std::vector<cv::Mat> &partImgs, bool doAngle, bool mostAngle,
+                                 CancelToken *token, Workspace &workspace);
+
+    //sets every angle to the index most of them have
+    void setMostAngle(std::vector<Angle> &angles);
 
 private:
     Ort::Session *session;
     Ort::Env ortEnv = Ort::Env(ORT_LOGGING_LEVEL_ERROR, "AngleNet");
     Ort::SessionOptions sessionOptions = Ort::SessionOptions();
     int numThread = 0;
+    OrtProfiler profiler;
 
     std::vector<Ort::AllocatedStringPtr> inputNamesPtr;
     std::vector<Ort::AllocatedStringPtr> outputNamesPtr;
@@ -33,7 +45,7 @@ private:
     const int dstWidth = 192;
     const int dstHeight = 48;
 
-    Angle getAngle(cv::Mat &src);
+    Angle getAngle(cv::Mat &src, CancelToken *token, Workspace &workspace);
 };
 
 
@@ -9,5 +9,28 @@ void bitmapToMat(JNIEnv *env, jobject bitmap, cv::Mat &dst);
 
 void matToBitmap(JNIEnv *env, cv::Mat &src, jobject bitmap);
 
+cv::Size getBitmapSize(JNIEnv *env, jobject bitmap);
+
+//Pixels of an RGBA_8888 bitmap of the given size, locked while the object lives so boxes can be drawn
+//straight into them; mat stays empty and nothing is locked for a null bitmap, another format or size
+class LockedBitmap {
+public:
+    LockedBitmap(JNIEnv *env, jobject bitmap, cv::Size size);
+
+    ~LockedBitmap();
+
+    cv::Mat mat;
+
+private:
+    JNIEnv *env;
+    jobject bitmap;
+};
+
+//BGR image converted straight from the locked pixels: one pass instead of copy and cvtColor
+void bitmapToBgrMat(JNIEnv *env, jobject bitmap, cv::Mat &dst);
+
+//same for an RGBA Mat already read from a bitmap
+void rgbaToBgrMat(const cv::Mat &src, cv::Mat &dst);
+
 
 #endif //__OCR_LITE_BITMAP_UTILS_H__
@@ -0,0 +1,66 @@
+#ifndef __OCR_BLOCKING_QUEUE_H__
+#define __OCR_BLOCKING_QUEUE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+//Bounded FIFO between pipeline stages; push blocks while full, pop blocks while empty
+template<typename T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    //returns false once the queue is closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.emplace_back(std::move(item));
+        depthSum += items.size();
+        depthSamples++;
+        notEmpty.notify_one();
+        return true;
+    }
+
+    //returns false when the queue is closed and drained
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+
+    //mean depth seen by push, including the pushed item
+    double getMeanDepth() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return depthSamples > 0 ? depthSum / depthSamples : 0.0;
+    }
+
+private:
+    const size_t capacity;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    bool closed = false;
+    double depthSum = 0.0;
+    long depthSamples = 0;
+};
+
+#endif //__OCR_BLOCKING_QUEUE_H__
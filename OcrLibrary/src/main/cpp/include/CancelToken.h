@@ -0,0 +1,39 @@
+#ifndef __OCR_CANCEL_TOKEN_H__
+#define __OCR_CANCEL_TOKEN_H__
+
+#include <atomic>
+#include "onnxruntime/core/session/onnxruntime_cxx_api.h"
+
+//Shared by one detect call and whoever may cancel it; terminate also aborts the running ort session
+class CancelToken {
+public:
+    CancelToken();
+
+    ~CancelToken();
+
+    void cancel();
+
+    //deadline in getCurrentTime() milliseconds, <= 0 means none
+    void setDeadline(double time);
+
+    //stops the in-flight ort run without marking the call cancelled (deadline reached)
+    void terminate();
+
+    bool isCancelled();
+
+    //cancelled, terminated or past the deadline: no more work should be scheduled
+    bool isStopped();
+
+    Ort::RunOptions &getRunOptions();
+
+private:
+    std::atomic<bool> cancelled;
+    std::atomic<bool> terminated;
+    double deadline = 0;
+    Ort::RunOptions runOptions;
+};
+
+//RunOptions of token, or an empty one when there is no token
+Ort::RunOptions &getRunOptions(CancelToken *token);
+
+#endif //__OCR_CANCEL_TOKEN_H__
@@ -2,11 +2,21 @@
 #define __OCR_CRNNNET_H__
 
 #include "OcrStruct.h"
+#include "TextPattern.h"
+#include "CancelToken.h"
+#include "Workspace.h"
+#include "OrtProfiler.h"
 #include "onnxruntime/core/session/onnxruntime_cxx_api.h"
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
-#include <android/asset_manager.h>
-#include <android/asset_manager_jni.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include "OcrUtils.h"
 
 class CrnnNet {
 public:
@@ -19,13 +29,43 @@ public:
 
     void initModel(AAssetManager *mgr, const std::string &name, const std::string &keysName);
 
-    std::vector<TextLine> getTextLines(std::vector<cv::Mat> &partImg);
+    //profile the next runs, see OrtProfiler
+    bool startProfiling(const std::string &prefix, int runs);
+
+    std::vector<OpProfile> getOpProfiles();
+
+    void setMaxWidth(int width);
+
+    void setWidthQuantum(int quantum);
+
+    void getShapeStats(int &rawShapes, int &runShapes);
+
+    void resetShapeStats();
+
+    int getCacheSize();
+
+    void setCacheSize(int size);
+
+    //width of src once scaled to the model input height
+    int getInputWidth(const cv::Mat &src);
+
+    //built once per allowedChars and shared by every call using it
+    std::shared_ptr<const std::vector<int>> getCharsetIndexes(const std::string &allowedChars);
+
+    //compiled once per (pattern, luhnCheck) and shared by every call using it
+    std::shared_ptr<const TextPattern> getTextPattern(const std::string &pattern, bool luhnCheck);
+
+    std::vector<TextLine> getTextLines(std::vector<cv::Mat> &partImg,
+                                       const std::vector<int> &charsetIndexes,
+                                       const TextPattern &textPattern, CancelToken *token,
+                                       Workspace &workspace);
 
 private:
     Ort::Session *session;
     Ort::Env ortEnv = Ort::Env(ORT_LOGGING_LEVEL_ERROR, "CrnnNet");
     Ort::SessionOptions sessionOptions = Ort::SessionOptions();
     int numThread = 0;
+    OrtProfiler profiler;
 
     std::vector<Ort::AllocatedStringPtr> inputNamesPtr;
     std::vector<Ort::AllocatedStringPtr> outputNamesPtr;
@@ -33,13 +73,61 @@ private:
     const float meanValues[3] = {127.5, 127.5, 127.5};
     const float normValues[3] = {1.0 / 127.5, 1.0 / 127.5, 1.0 / 127.5};
     const int dstHeight = 48;
+    const int beamWidth = 10;
+    const int chunkOverlap = 48;
+    const int chunkBatch = 4;
+    std::atomic<int> maxWidth{1600};
+    std::atomic<int> widthQuantum{0};
+
+    //distinct input widths before and after quantization
+    std::mutex shapeMutex;
+    std::set<int> rawWidths;
+    std::set<int> runWidths;
+
+    void addShape(int rawWidth, int runWidth);
 
     std::vector<std::string> keys;
 
-    TextLine scoreToTextLine(const std::vector<float> &outputData, int h, int w);
+    //charsets and patterns compiled against keys, an app uses a handful; cleared when keys load
+    const size_t maxCompiled = 32;
+    std::mutex compiledMutex;
+    std::map<std::string, std::shared_ptr<const std::vector<int>>> charsetCache;
+    std::map<std::pair<std::string, bool>, std::shared_ptr<const TextPattern>> patternCache;
+
+    std::vector<int> buildCharsetIndexes(const std::string &allowedChars);
+
+    //lru cache of recognized lines, most recently used first
+    std::atomic<int> cacheSize{0};
+    std::mutex cacheMutex;
+    std::list<std::pair<uint64_t, TextLine>> cacheList;
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, TextLine>>::iterator> cacheMap;
+
+    bool getCachedTextLine(uint64_t key, TextLine &textLine);
+
+    void putCachedTextLine(uint64_t key, const TextLine &textLine);
 
-    TextLine getTextLine(cv::Mat &src);
+    TextLine scoreToTextLine(const std::vector<float> &outputData, int h, int w,
+                             const std::vector<int> &charsetIndexes);
+
+    bool beamSearchToTextLine(const std::vector<float> &outputData, int h, int w,
+                              const TextPattern &textPattern, TextLine &textLine);
+
+    void getOutputData(std::vector<float> &inputTensorValues, int batch, int width,
+                       std::vector<int64_t> &outputShape, std::vector<float> &outputData,
+                       CancelToken *token, MemoryMeter *meter);
+
+    void getChunkedOutputData(cv::Mat &srcResize, int windowWidth, int &steps, int &classes,
+                              std::vector<float> &outputData, CancelToken *token,
+                              Workspace &workspace);
+
+    TextLine getTextLine(cv::Mat &src, const std::vector<int> &charsetIndexes,
+                         const TextPattern &textPattern, uint64_t decodeKey, CancelToken *token,
+                         Workspace &workspace);
 };
 
+//greedy ctc decode of h steps x w classes, keys[0] is the blank
+TextLine scoreToTextLine(const std::vector<float> &outputData, int h, int w,
+                         const std::vector<std::string> &keys, const std::vector<int> &charsetIndexes);
+
 
 #endif //__OCR_CRNNNET_H__
@@ -2,11 +2,13 @@
 #define __OCR_DBNET_H__
 
 #include "OcrStruct.h"
+#include "CancelToken.h"
+#include "Workspace.h"
+#include "OrtProfiler.h"
 #include "onnxruntime/core/session/onnxruntime_cxx_api.h"
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
-#include <android/asset_manager.h>
-#include <android/asset_manager_jni.h>
+#include "OcrUtils.h"
 
 class DbNet {
 public:
@@ -18,14 +20,21 @@ public:
 
     void initModel(AAssetManager *mgr, const std::string &name);
 
+    //profile the next runs, see OrtProfiler
+    bool startProfiling(const std::string &prefix, int runs);
+
+    std::vector<OpProfile> getOpProfiles();
+
     std::vector<TextBox> getTextBoxes(cv::Mat &src, ScaleParam &s, float boxScoreThresh,
-                                      float boxThresh, float unClipRatio);
+                                      float boxThresh, float unClipRatio, CancelToken *token,
+                                      Workspace &workspace, StageTimes &times, StageCounters &counters);
 
 private:
     Ort::Session *session;
     Ort::Env ortEnv = Ort::Env(ORT_LOGGING_LEVEL_ERROR, "DbNet");
     Ort::SessionOptions sessionOptions = Ort::SessionOptions();
     int numThread = 0;
+    OrtProfiler profiler;
 
     std::vector<Ort::AllocatedStringPtr> inputNamesPtr;
     std::vector<Ort::AllocatedStringPtr> outputNamesPtr;
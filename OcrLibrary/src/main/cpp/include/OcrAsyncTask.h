@@ -0,0 +1,33 @@
+#ifndef __OCR_ASYNC_TASK_H__
+#define __OCR_ASYNC_TASK_H__
+
+#include <future>
+#include <mutex>
+#include "OcrStruct.h"
+#include "CancelToken.h"
+
+class OcrLite;
+
+//One detect running on its own thread, cancellable and optionally bounded by a timeout
+class OcrAsyncTask {
+public:
+    //timeout in milliseconds from now, <= 0 means none
+    OcrAsyncTask(OcrLite *ocrLite, OcrFrame frame, double timeout);
+
+    ~OcrAsyncTask();
+
+    void cancel();
+
+    //waits for the result; at the deadline the running ort session is terminated and the
+    //partial result is returned. returns false when the task was cancelled
+    bool get(OcrResult &result);
+
+private:
+    std::shared_ptr<CancelToken> cancelToken;
+    //get may be called for one handle from two threads, the future itself is not thread safe
+    std::mutex futureMutex;
+    std::future<OcrResult> future;
+    double deadline = 0;
+};
+
+#endif //__OCR_ASYNC_TASK_H__
@@ -0,0 +1,18 @@
+#ifndef __OCR_LISTENER_H__
+#define __OCR_LISTENER_H__
+
+#include "OcrStruct.h"
+
+//Progressive results of one detect call, invoked on the calling thread
+class OcrListener {
+public:
+    virtual ~OcrListener() {}
+
+    //every box DbNet found, in original image coordinates, before any of them is cropped
+    virtual void onTextBoxes(std::vector<TextBox> &textBoxes) = 0;
+
+    //index into the boxes given to onTextBoxes, boxes left out by the budget never get one
+    virtual void onTextBlock(int index, TextBlock &textBlock) = 0;
+};
+
+#endif //__OCR_LISTENER_H__
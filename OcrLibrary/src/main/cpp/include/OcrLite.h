@@ -1,12 +1,16 @@
 #ifndef __OCR_LITE_H__
 #define __OCR_LITE_H__
 
+#include <atomic>
+#include <mutex>
 #include "opencv2/core.hpp"
 #include "onnxruntime/core/session/onnxruntime_cxx_api.h"
 #include "OcrStruct.h"
 #include "DbNet.h"
 #include "AngleNet.h"
 #include "CrnnNet.h"
+#include "WorkStealingPool.h"
+#include "Workspace.h"
 
 class OcrLite {
 public:
@@ -14,8 +18,36 @@ public:
 
     ~OcrLite();
 
-    void init(JNIEnv *jniEnv, jobject assetManager, int numOfThread, std::string detName,
-              std::string clsName, std::string recName, std::string keysName);
+    //boxWorkers > 1: crop, angle and crnn of different boxes run concurrently on that many threads
+    //mgr null: the model names are file paths
+    void init(AAssetManager *mgr, int numOfThread, int boxWorkers,
+              std::string detName, std::string clsName, std::string recName, std::string keysName);
+
+    void setMaxRecWidth(int width);
+
+    void setRecCacheSize(int size);
+
+    void setRecWidthQuantum(int quantum);
+
+    void getRecShapeStats(int &rawShapes, int &runShapes);
+
+    void resetRecShapeStats();
+
+    std::vector<WorkerStats> getBoxWorkerStats();
+
+    void resetBoxWorkerStats();
+
+    //heap allocations of detect temporaries, allocations served from kept buffers, bytes kept
+    void getWorkspaceStats(long &allocations, long &reuses, long &heldBytes);
+
+    //fills the heap growth of each net in MemoryStats, costs a mallinfo per ort run
+    void setMemoryProbe(bool enabled);
+
+    //ort profiles the next runs of each net to prefix + dbNet/angleNet/crnnNet + timestamp + .json
+    bool startProfiling(const std::string &prefix, int runs);
+
+    //topK operator types of each net by kernel time, from the last finished profiles
+    std::string getProfileSummary(int topK);
 
     //void initLogger(bool isDebug);
 
@@ -23,13 +55,47 @@ public:
 
     OcrResult detect(cv::Mat &src, cv::Rect &originRect, ScaleParam &scale,
                      float boxScoreThresh, float boxThresh,
-                     float unClipRatio, bool doAngle, bool mostAngle);
+                     float unClipRatio, bool doAngle, bool mostAngle,
+                     const std::string &allowedChars,
+                     const std::string &textPattern, bool luhnCheck);
+
+    OcrResult detect(OcrFrame &frame);
+
+    //detect split in two stages, so frames can be pipelined
+    void detectTextBoxes(OcrFrame &frame);
+
+    OcrResult recognizeTextBoxes(OcrFrame &frame);
 
 private:
     bool isLOG = true;
     DbNet dbNet;
     AngleNet angleNet;
     CrnnNet crnnNet;
+    std::unique_ptr<WorkStealingPool> boxPool;
+    //scratch buffers of detect calls, one workspace per frame and per running box task
+    WorkspacePool workspacePool;
+
+    //running cost of angle + crnn per input column (part image scaled to crnn height), 0 until measured
+    std::mutex lineCostMutex;
+    double lineCostPerCol = 0.0;
+
+    std::atomic<bool> memoryProbe{false};
+
+    //boxIndexes: position of each kept box before the selection, left empty when every box is kept
+    void selectBudgetBoxes(OcrFrame &frame, std::vector<TextBox> &skippedBoxes, std::vector<int> &boxIndexes);
+
+    //crops, classifies and recognizes one box after the other, reporting each line at once
+    std::vector<TextLine> getTextLinesProgressive(OcrFrame &frame, std::vector<Angle> &angles,
+                                                  const std::vector<int> &boxIndexes,
+                                                  const std::vector<int> &charsetIndexes,
+                                                  const TextPattern &pattern);
+
+    std::vector<TextLine> getTextLinesPooled(OcrFrame &frame, std::vector<Angle> &angles,
+                                             const std::vector<int> &charsetIndexes,
+                                             const TextPattern &pattern);
+
+    void updateLineCost(std::vector<cv::Mat> &partImages, std::vector<Angle> &angles,
+                        std::vector<TextLine> &textLines);
 };
 
 
@@ -0,0 +1,87 @@
+#ifndef __OCR_RESULT_BINARY_H__
+#define __OCR_RESULT_BINARY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include "OcrStruct.h"
+
+//Binary OcrResult, all values little-endian and packed without alignment:
+//header (44 bytes):
+//  u8[4] magic "OCRB", u16 version, u16 flags (bit 0: partial), u32 total size in bytes,
+//  u32 block count, u32 skipped box count, i32 cacheHits, i32 cacheMisses, f64 dbNetTime, f64 detectTime
+//per text block:
+//  i32[8] box points x0,y0..x3,y3, f32 boxScore, i32 angleIndex, f32 angleScore,
+//  f64 angleTime, f64 crnnTime, f64 blockTime, u32 text bytes, u32 char count,
+//  UTF-8 text (no terminator), f32[char count] char scores
+//per skipped box:
+//  i32[8] box points, f32 score
+#define OCR_BINARY_VERSION 1
+
+size_t getBinaryResultSize(const OcrResult &ocrResult);
+
+//writes ocrResult into buffer, returns the bytes written or 0 when capacity is too small
+size_t writeBinaryResult(const OcrResult &ocrResult, uint8_t *buffer, size_t capacity);
+
+//One text block of a binary result, text and charScores point into the buffer
+struct BinaryTextBlock {
+    int32_t boxPoint[8];
+    float boxScore;
+    int32_t angleIndex;
+    float angleScore;
+    double angleTime;
+    double crnnTime;
+    double blockTime;
+    const char *text;
+    uint32_t textLength;
+    const uint8_t *charScores;
+    uint32_t charCount;
+
+    float getCharScore(uint32_t index) const;
+};
+
+struct BinaryTextBox {
+    int32_t boxPoint[8];
+    float score;
+};
+
+//Reads a binary result in place, nothing is copied or allocated
+class BinaryResultReader {
+public:
+    BinaryResultReader(const uint8_t *buffer, size_t size);
+
+    //magic, version and sizes check out
+    bool isValid() const;
+
+    //total size from the header, where the next result starts when results are written back to back
+    size_t getSize() const;
+
+    bool isPartial() const;
+
+    uint32_t getBlockCount() const;
+
+    uint32_t getSkippedCount() const;
+
+    int32_t getCacheHits() const;
+
+    int32_t getCacheMisses() const;
+
+    double getDbNetTime() const;
+
+    double getDetectTime() const;
+
+    //blocks in order, false after the last one
+    bool nextBlock(BinaryTextBlock &block);
+
+    //skipped boxes, after all blocks were read
+    bool nextSkippedBox(BinaryTextBox &textBox);
+
+private:
+    const uint8_t *buffer;
+    size_t size;
+    bool valid;
+    size_t offset;
+    uint32_t blocksRead;
+    uint32_t skippedRead;
+};
+
+#endif //__OCR_RESULT_BINARY_H__
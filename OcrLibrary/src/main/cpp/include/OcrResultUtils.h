@@ -8,22 +8,33 @@ class OcrResultUtils {
 public:
     OcrResultUtils(JNIEnv *env, OcrResult &ocrResult, jobject boxImg);
 
+    //only for building single TextBlock/TextBox objects or a FlatOcrResult
+    explicit OcrResultUtils(JNIEnv *env);
+
     ~OcrResultUtils();
 
+    //looks up the result classes and their methods once, call from JNI_OnLoad
+    static bool initJniIds(JNIEnv *env);
+
     jobject getJObject();
 
+    jobject getTextBlock(TextBlock &textBlock);
+
+    jobject getTextBoxes(std::vector<TextBox> &textBoxes);
+
+    //all lines as a few primitive arrays and one String array, no object per point or line
+    jobject getFlatResult(OcrResult &ocrResult, jobject boxImg);
+
 private:
     JNIEnv *jniEnv;
     jobject jOcrResult;
 
-    jclass newJListClass();
-
-    jmethodID getListConstructor(jclass clazz);
-
-    jobject getTextBlock(TextBlock &textBlock);
+    jobject newJList(int capacity);
 
     jobject getTextBlocks(std::vector<TextBlock> &textBlocks);
 
+    jobject getTextBox(TextBox &textBox);
+
     jobject newJPoint(cv::Point &point);
 
     jobject newJBoxPoint(std::vector<cv::Point> &boxPoint);
@@ -0,0 +1,87 @@
+#ifndef __OCR_STREAM_H__
+#define __OCR_STREAM_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "OcrStruct.h"
+#include "BlockingQueue.h"
+
+class OcrLite;
+
+struct OcrStreamStats {
+    double detectOccupancy;//busy time / elapsed time of the detection stage
+    double recognizeOccupancy;//busy time / elapsed time of the recognition stage
+    double inputQueueDepth;
+    double detectedQueueDepth;
+    double outputQueueDepth;
+    long frames;
+    double framesPerSecond;
+};
+
+//Pipelines frames through OcrLite: DbNet of frame N+1 runs while frame N is recognized.
+//A frame whose detect fails is logged and popped as an empty partial result
+class OcrStream {
+public:
+    OcrStream(OcrLite *ocrLite, int queueSize);
+
+    ~OcrStream();
+
+    //numbers the frame from 0 in push order, returns its id or -1 once closed
+    long push(OcrFrame frame);
+
+    bool pop(long &frameId, OcrResult &result);
+
+    //no more frames: already queued frames are still finished and can be popped
+    void finish();
+
+    //drops the queued frames, blocked push and pop calls return false
+    void close();
+
+    OcrStreamStats getStats();
+
+private:
+    OcrLite *ocrLite;
+    BlockingQueue<OcrFrame> inputQueue;
+    BlockingQueue<OcrFrame> detectedQueue;
+    BlockingQueue<std::pair<long, OcrResult>> outputQueue;
+    std::thread detectThread;
+    std::thread recognizeThread;
+
+    double startTime;
+    std::atomic<double> detectBusyTime;
+    std::atomic<double> recognizeBusyTime;
+    std::atomic<long> frameCount;
+    std::atomic<long> nextFrameId;
+
+    void detectLoop();
+
+    void recognizeLoop();
+};
+
+//The restartable stream of one engine. start and stop may run while other threads push and pop: a call
+//keeps the stream it got alive, and stop closes that stream so its blocked calls return
+class OcrStreamSlot {
+public:
+    explicit OcrStreamSlot(OcrLite *ocrLite);
+
+    ~OcrStreamSlot();
+
+    //replaces the running stream
+    void start(int queueSize);
+
+    void stop();
+
+    //null when not started
+    std::shared_ptr<OcrStream> get();
+
+private:
+    OcrLite *ocrLite;
+    std::mutex mutex;
+    std::shared_ptr<OcrStream> stream;
+
+    void replace(std::shared_ptr<OcrStream> next);
+};
+
+#endif //__OCR_STREAM_H__
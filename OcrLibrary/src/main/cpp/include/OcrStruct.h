@@ -3,6 +3,24 @@
 
 #include "opencv2/core.hpp"
 #include <vector>
+#include <memory>
+
+class CancelToken;
+
+class OcrListener;
+
+class Workspace;
+
+class WorkspacePool;
+
+//Gives a frame's workspace back to its pool, also when the frame is dropped by a stream or an exception
+struct WorkspaceReleaser {
+    WorkspacePool *pool;
+
+    void operator()(Workspace *workspace) const;
+};
+
+typedef std::unique_ptr<Workspace, WorkspaceReleaser> FrameWorkspace;
 
 struct ScaleParam {
     int srcWidth;
@@ -11,6 +29,8 @@ struct ScaleParam {
     int dstHeight;
     float ratioWidth;
     float ratioHeight;
+    //white border around src that only exists in the det tensor, counted in srcWidth/srcHeight
+    int padding;
 };
 
 struct TextBox {
@@ -28,6 +48,7 @@ struct TextLine {
     std::string text;
     std::vector<float> charScores;
     double time;
+    bool cached;
 };
 
 struct TextBlock {
@@ -42,12 +63,102 @@ struct TextBlock {
     double blockTime;
 };
 
+//Wall time in ms of each detect stage, angle and crnn are summed over boxes (they overlap with boxWorkers)
+struct StageTimes {
+    double dbPreprocess;//resize + normalize
+    double dbInference;
+    double dbPostprocess;//threshold, dilate, contours
+    double crop;
+    double angle;
+    double crnn;
+};
+
+//Bytes used by one detect call: peaks of its workspace Mats and tensor buffers per stage, and with
+//the heap probe on, how much the process heap grew during the ort runs of each net (arena growth)
+struct MemoryStats {
+    long detectPeak;
+    long cropPeak;
+    long recognizePeak;//angle + crnn
+    long largestMat;
+    //process heap growth across the Session::Run calls of each net, not bytes the net holds
+    long dbNetHeapGrowth;
+    long angleNetHeapGrowth;
+    long crnnNetHeapGrowth;
+    //heap in use at the end of the call minus at its start: what the call still holds (boxes, crops, text) plus
+    //whatever it allocated outside the workspace and did not free. Process wide, so concurrent calls add up
+    long frameHeapGrowth;
+};
+
+//Hardware counters over one stage, summed over every thread of the process (ort pools included)
+struct PerfSample {
+    long cycles;
+    long instructions;
+    long cacheMisses;
+    long branchMisses;
+};
+
+//Counters of each detect stage while the perf counters are on (Linux hosts), all 0 otherwise. With
+//box workers the angle and crnn runs of different boxes overlap, so only recognize is filled then
+struct StageCounters {
+    PerfSample dbPreprocess;
+    PerfSample dbInference;
+    PerfSample dbPostprocess;
+    PerfSample crop;
+    PerfSample angle;
+    PerfSample crnn;
+    PerfSample recognize;//angle + crnn + decode
+};
+
 struct OcrResult {
     double dbNetTime;
     std::vector<TextBlock> textBlocks;
     cv::Mat boxImg;
     double detectTime;
     std::string strRes;
+    int cacheHits;
+    int cacheMisses;
+    bool partial;//stopped by cancel or deadline before every box was recognized
+    std::vector<TextBox> skippedBoxes;//left out to stay within the latency budget
+    StageTimes stageTimes;
+    MemoryStats memoryStats;
+    StageCounters stageCounters;
+};
+
+//One image travelling through detect: input and options, then the detection stage output
+struct OcrFrame {
+    long id;
+    cv::Mat src;
+    cv::Rect originRect;
+    ScaleParam scale;
+    float boxScoreThresh;
+    float boxThresh;
+    float unClipRatio;
+    bool doAngle;
+    bool mostAngle;
+    std::string allowedChars;
+    std::string textPattern;
+    bool luhnCheck;
+    std::shared_ptr<CancelToken> cancelToken;
+    //render boxes into boxImg; a caller-provided boxImg (BGR or RGBA, original size, already holding the
+    //image) is drawn in place, otherwise a BGR copy of the original is made
+    bool drawBoxImg;
+    //latency budget in ms for the whole call, boxes that do not fit are skipped, <= 0 means none
+    double budget;
+    //emit boxes after detection and each TextBlock once recognized, null for a single result
+    OcrListener *listener;
+    //with a listener: recognize largest boxes first instead of reading order
+    bool largestFirst;
+    //scratch buffers, taken by detectTextBoxes and given back by recognizeTextBoxes or with the frame
+    FrameWorkspace workspace;
+
+    double startTime;
+    double dbNetTime;
+    std::vector<TextBox> textBoxes;
+    std::vector<cv::Mat> partImages;
+    cv::Mat boxImg;
+    StageTimes stageTimes;
+    MemoryStats memoryStats;
+    StageCounters stageCounters;
 };
 
 #endif //__OCR_STRUCT_H__
@@ -4,6 +4,8 @@
 #include <opencv2/core.hpp>
 #include "OcrStruct.h"
 #include "onnxruntime/core/session/onnxruntime_cxx_api.h"
+
+#ifdef __ANDROID__
 #include <android/log.h>
 #include <android/asset_manager.h>
 #include <android/asset_manager_jni.h>
@@ -14,6 +16,18 @@
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO,TAG,__VA_ARGS__)
 #define LOGW(...) __android_log_print(ANDROID_LOG_WARN,TAG,__VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR,TAG,__VA_ARGS__)
+#else
+#include <cstdio>
+
+//host build: no assets, the manager is always null and models are read from file paths
+struct AAssetManager;
+
+#define LOGV(...) ((void) 0)
+#define LOGD(...) ((void) 0)
+#define LOGI(...) ((void) 0)
+#define LOGW(...) (fprintf(stderr, __VA_ARGS__), (void) fputc('\n', stderr))
+#define LOGE(...) (fprintf(stderr, __VA_ARGS__), (void) fputc('\n', stderr))
+#endif
 
 #define __ENABLE_CONSOLE__ false
 #define Logger(format, ...) {\
@@ -53,10 +67,16 @@ inline T clamp(T x, T min, T max) {
 
 double getCurrentTime();
 
+//bytes allocated from the process heap right now, including large mmapped blocks
+long getHeapInUse();
+
 ScaleParam getScaleParam(cv::Mat &src, const float scale);
 
 ScaleParam getScaleParam(cv::Mat &src, const int targetSize);
 
+//scale for src with a virtual white border of padding on every side, targetSize includes the border
+ScaleParam getScaleParam(cv::Mat &src, int padding, const int targetSize);
+
 cv::RotatedRect getPartRect(std::vector<cv::Point> &box, float scaleWidth, float scaleHeight);
 
 int getThickness(cv::Mat &boxImg);
@@ -65,17 +85,20 @@ std::vector<cv::Point2f> getBox(const cv::RotatedRect &rect);
 
 void drawTextBox(cv::Mat &boxImg, cv::RotatedRect &rect, int thickness);
 
-void drawTextBox(cv::Mat &boxImg, const std::vector<cv::Point> &box, int thickness);
+void drawTextBox(cv::Mat &boxImg, const std::vector<cv::Point> &box, int thickness,
+                 const cv::Point &offset, const cv::Scalar &color);
 
-void drawTextBoxes(cv::Mat &boxImg, std::vector<TextBox> &textBoxes, int thickness);
+//boxImg is BGR or RGBA, box points are moved by -offset
+void drawTextBoxes(cv::Mat &boxImg, std::vector<TextBox> &textBoxes, int thickness, const cv::Point &offset);
 
 cv::Mat matRotateClockWise180(cv::Mat src);
 
 cv::Mat matRotateClockWise90(cv::Mat src);
 
-cv::Mat getRotateCropImage(const cv::Mat &src, std::vector<cv::Point> box);
+//allocator of the returned Mat, null for the default one
+cv::Mat getRotateCropImage(const cv::Mat &src, std::vector<cv::Point> box, cv::MatAllocator *allocator);
 
-cv::Mat adjustTargetImg(cv::Mat &src, int dstWidth, int dstHeight);
+cv::Mat adjustTargetImg(cv::Mat &src, int dstWidth, int dstHeight, cv::MatAllocator *allocator);
 
 std::vector<cv::Point2f> getMinBoxes(const cv::RotatedRect &boxRect, float &maxSideLen);
 
@@ -83,17 +106,31 @@ float boxScoreFast(const std::vector<cv::Point2f> &boxes, const cv::Mat &pred);
 
 cv::RotatedRect unClip(std::vector<cv::Point2f> box, float unClipRatio);
 
+uint64_t getMatFingerprint(const cv::Mat &src);
+
 std::vector<float>
 substractMeanNormalize(cv::Mat &src, const float *meanVals, const float *normVals);
 
+void substractMeanNormalize(cv::Mat &src, const float *meanVals, const float *normVals,
+                            std::vector<float> &inputTensorValues);
+
+//src normalized into a dstWidth x dstHeight tensor at (left, top), the rest filled with normalized white
+void substractMeanNormalize(cv::Mat &src, int left, int top, int dstWidth, int dstHeight,
+                            const float *meanVals, const float *normVals, std::vector<float> &inputTensorValues);
+
 std::vector<int> getAngleIndexes(std::vector<Angle> &angles);
 
 std::vector<Ort::AllocatedStringPtr> getInputNames(Ort::Session *session);
 
 std::vector<Ort::AllocatedStringPtr> getOutputNames(Ort::Session *session);
 
+//from the assets, or from the file modelName when mgr is null; malloc'd and 0 terminated, free it
 void *getModelDataFromAssets(AAssetManager *mgr, const char *modelName, int &size);
 
+#ifdef __ANDROID__
 std::string jstringTostring(JNIEnv *env, jstring input);
+#endif
+
+std::vector<std::string> splitUtf8(const std::string &str);
 
 #endif //__OCR_UTILS_H__
@@ -0,0 +1,70 @@
+#ifndef __OCR_ORT_PROFILER_H__
+#define __OCR_ORT_PROFILER_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "onnxruntime/core/session/onnxruntime_cxx_api.h"
+#include "OcrUtils.h"
+
+//Kernel time of one operator type summed over the profiled runs
+struct OpProfile {
+    std::string opType;
+    long calls;
+    double time;//ms
+};
+
+//ORT profiling can only be switched on when a session is created, so a net being profiled runs its
+//next runs on a second, profiling session of the same model; when they are done the profile file is
+//summarized per operator type. The file stays on disk, it is a chrome trace too
+class OrtProfiler {
+public:
+    //where the model is reloaded from, mgr must stay valid (the Java AssetManager of the app)
+    void setModel(AAssetManager *mgr, const std::string &name);
+
+    //profile the next runs of the net, the file is written to prefix + timestamp + .json
+    bool start(Ort::Env &env, Ort::SessionOptions &options, const std::string &prefix, int runs);
+
+    //summary of the last finished profile, most expensive first
+    std::vector<OpProfile> getOpProfiles();
+
+    //file of the last finished profile
+    std::string getProfileFile();
+
+    //While alive, session() is the profiling session if this run was picked for profiling
+    class Run {
+    public:
+        explicit Run(OrtProfiler &profiler);
+
+        ~Run();
+
+        //profiling session, or the one passed in when this run is not profiled
+        Ort::Session *session(Ort::Session *normal);
+
+    private:
+        OrtProfiler &profiler;
+        std::shared_ptr<Ort::Session> profiled;
+    };
+
+private:
+    AAssetManager *mgr = nullptr;
+    std::string name;
+
+    std::mutex mutex;
+    std::atomic<int> runsLeft{0};
+    int runsPending = 0;//taken but not finished, guarded by mutex
+    std::shared_ptr<Ort::Session> session;
+    std::vector<OpProfile> opProfiles;
+    std::string profileFile;
+
+    std::shared_ptr<Ort::Session> take();
+
+    void finish(const std::shared_ptr<Ort::Session> &finished);
+};
+
+//opType, calls, total and share of the kernel time, one per line
+std::string formatOpProfiles(const std::string &title, const std::vector<OpProfile> &opProfiles, int topK);
+
+#endif //__OCR_ORT_PROFILER_H__
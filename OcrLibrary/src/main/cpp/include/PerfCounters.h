@@ -0,0 +1,36 @@
+#ifndef __OCR_PERF_COUNTERS_H__
+#define __OCR_PERF_COUNTERS_H__
+
+#include "OcrStruct.h"
+
+//Hardware counters (perf_event_open, user space only) of every thread of the process, process wide
+//and off by default. Linux hosts only: elsewhere, or when kernel.perf_event_paranoid forbids it,
+//starting fails and every sample stays 0. Work of concurrent detect calls is counted in each of them
+
+//opens the counters of the threads running now, false when the main counters are not available
+bool startPerfCounters();
+
+void stopPerfCounters();
+
+bool isPerfCountersEnabled();
+
+//counts since startPerfCounters, threads started since the last read are picked up from now on
+PerfSample readPerfCounters();
+
+//sum += end - start
+void addPerfSample(PerfSample &sum, const PerfSample &start, const PerfSample &end);
+
+//Adds the counts from construction to destruction to sum
+class PerfScope {
+public:
+    explicit PerfScope(PerfSample &sum);
+
+    ~PerfScope();
+
+private:
+    PerfSample &sum;
+    bool enabled;
+    PerfSample start;
+};
+
+#endif //__OCR_PERF_COUNTERS_H__
@@ -0,0 +1,94 @@
+#ifndef __OCR_TEXT_PATTERN_H__
+#define __OCR_TEXT_PATTERN_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+//Compiled regex subset used to constrain ctc beam search.
+//Supports literals, ., \d \w \s, [...] / [^...] with ranges, (...), |, ?, *, +, {n}, {n,}, {n,m};
+//^ and $ are accepted and ignored, the pattern always matches the whole text line.
+//The dfa is built completely by compile, so a compiled pattern can be shared by threads.
+class TextPattern {
+public:
+    TextPattern();
+
+    ~TextPattern();
+
+    bool compile(const std::string &pattern, const std::vector<std::string> &keys);
+
+    bool empty() const;
+
+    const std::string &getPattern() const;
+
+    bool getLuhnCheck() const;
+
+    void setLuhnCheck(bool check);
+
+    int startState() const;
+
+    //(keyIndex, nextState) pairs reachable from state
+    const std::vector<std::pair<int, int>> &transitions(int state) const;
+
+    bool isAccept(int state) const;
+
+    bool check(const std::string &text) const;
+
+private:
+    struct Node {
+        int type;
+        std::vector<int> indexes;
+        std::vector<Node> children;
+        int min;
+        int max;
+    };
+
+    struct NfaState {
+        int classId;//>=0 char class, -1 epsilon, -2 match
+        std::vector<int> outs;
+    };
+
+    std::string src;
+    size_t pos = 0;
+    bool ok = false;
+    bool luhnCheck = false;
+    const std::vector<std::string> *keyList = nullptr;
+    std::map<std::string, int> keyIndexes;
+
+    std::vector<std::vector<int>> classes;
+    std::vector<NfaState> nfa;
+    int nfaStart = -1;
+
+    std::vector<std::vector<int>> dfaSets;
+    std::map<std::vector<int>, int> dfaIds;
+    std::vector<std::vector<std::pair<int, int>>> dfaTrans;
+    std::vector<bool> dfaAccept;
+
+    bool parseAlt(Node &node);
+
+    bool parseConcat(Node &node);
+
+    bool parseRepeat(Node &node);
+
+    bool parseAtom(Node &node);
+
+    bool parseClass(Node &node);
+
+    bool nextCodePoint(unsigned int &cp, std::string &ch);
+
+    void addCodePoint(unsigned int cp, std::vector<int> &indexes);
+
+    void addChars(const std::string &chars, std::vector<int> &indexes);
+
+    int newState(int classId, std::vector<int> outs);
+
+    int compileNode(const Node &node, int next);
+
+    void closure(int state, std::vector<int> &set, std::vector<bool> &visited);
+
+    int getDfaState(std::vector<int> &set);
+
+    void buildTransitions(int state);
+};
+
+#endif //__OCR_TEXT_PATTERN_H__
@@ -0,0 +1,39 @@
+#ifndef __OCR_TRACE_H__
+#define __OCR_TRACE_H__
+
+#include <string>
+
+//Spans of the pipeline stages and box tasks, process wide and off by default. Spans go into a fixed
+//lock-free ring (the oldest are overwritten) and export as Chrome trace JSON for ui.perfetto.dev
+#define TRACE_CAPACITY (1 << 16)
+
+//clears the ring and starts recording
+void startTrace();
+
+void stopTrace();
+
+bool isTraceEnabled();
+
+//name shown for the calling thread, kept until the process ends
+void setTraceThreadName(const std::string &name);
+
+//times in getCurrentTime() ms; arg (box index, tensor width, count) is left out when < 0
+void addTraceSpan(const char *name, long arg, double startTime, double endTime);
+
+//spans recorded since the last startTrace, may be called while recording
+std::string getChromeTrace();
+
+//Span from construction to destruction, name must be a literal
+class TraceScope {
+public:
+    explicit TraceScope(const char *name, long arg = -1);
+
+    ~TraceScope();
+
+private:
+    const char *name;
+    long arg;
+    double startTime;//< 0 when tracing was off
+};
+
+#endif //__OCR_TRACE_H__
@@ -0,0 +1,74 @@
+#ifndef __OCR_WORK_STEALING_POOL_H__
+#define __OCR_WORK_STEALING_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct WorkerStats {
+    long tasks;
+    long steals;//tasks taken from another worker's queue
+    double busyTime;
+    double utilization;//busy time / time since start or reset
+};
+
+//Fixed set of workers with one queue each: a worker runs its own queue newest first and
+//steals the oldest task of another worker when its queue is empty
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int workerCount);
+
+    ~WorkStealingPool();
+
+    int getWorkerCount();
+
+    //spreads tasks over the workers and returns once all of them ran, may be called from many threads.
+    //The first exception of a task is rethrown here, the other tasks still run
+    void run(std::vector<std::function<void()>> &tasks);
+
+    std::vector<WorkerStats> getStats();
+
+    void resetStats();
+
+private:
+    struct Batch {
+        std::atomic<int> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;//guarded by mutex
+    };
+
+    struct Task {
+        std::function<void()> *func;
+        Batch *batch;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+        std::atomic<long> taskCount;
+        std::atomic<long> stealCount;
+        std::atomic<double> busyTime;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    long queued = 0;//guarded by sleepMutex
+    bool stopping = false;
+    std::atomic<unsigned> nextWorker;
+    std::atomic<double> startTime;
+
+    bool popTask(int index, Task &task, bool &stolen);
+
+    void workerLoop(int index);
+};
+
+#endif //__OCR_WORK_STEALING_POOL_H__
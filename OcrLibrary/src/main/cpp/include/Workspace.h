@@ -0,0 +1,207 @@
+#ifndef __OCR_WORKSPACE_H__
+#define __OCR_WORKSPACE_H__
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core.hpp>
+
+//access flags of cv::MatAllocator are an enum since OpenCV 4, int in the bundled 3.4
+#if CV_VERSION_MAJOR >= 4
+typedef cv::AccessFlag MatAccessFlag;
+#else
+typedef int MatAccessFlag;
+#endif
+
+//Mat allocator that keeps released buffers and hands them out again for the same or a slightly
+//smaller size, so frames of a steady camera stream reuse the buffers of the previous frame
+class WorkspaceAllocator : public cv::MatAllocator {
+public:
+    WorkspaceAllocator();
+
+    ~WorkspaceAllocator();
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           MatAccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+
+    bool allocate(cv::UMatData *data, MatAccessFlag accessFlags,
+                  cv::UMatUsageFlags usageFlags) const override;
+
+    void deallocate(cv::UMatData *data) const override;
+
+    //heap allocations made for the workspace (buffers and growing vectors), and buffers handed out again
+    void getStats(long &allocations, long &reuses, long &heldBytes) const;
+
+    void addAllocations(long count);
+
+private:
+    //released buffers above this are freed instead of kept
+    const size_t maxHeldBytes = 64 * 1024 * 1024;
+
+    mutable std::mutex mutex;
+    mutable std::multimap<size_t, uchar *> freeBuffers;
+    mutable std::unordered_map<uchar *, size_t> capacities;
+    mutable size_t heldBytes = 0;
+    mutable std::atomic<long> allocations;
+    mutable std::atomic<long> reuses;
+
+    uchar *takeBuffer(size_t size) const;
+};
+
+//Bytes of workspace Mats and tensor buffers in use by one detect call, shared by the workspace
+//of the call and the ones its box tasks lease
+class MemoryMeter {
+public:
+    enum Net {
+        DB_NET,
+        ANGLE_NET,
+        CRNN_NET,
+        NETS
+    };
+
+    MemoryMeter();
+
+    //new call: zero counters and a fresh id, so Mats of earlier calls are no longer subtracted
+    void reset();
+
+    long getId();
+
+    void add(long bytes);
+
+    void sub(long bytes);
+
+    void addMat(long bytes);
+
+    //peak of the next stage starts at what is in use now
+    void startStage();
+
+    long getPeak();
+
+    long getLargestMat();
+
+    //sample the process heap around each ort run, costs a mallinfo per run
+    void setHeapProbe(bool enabled);
+
+    bool isHeapProbe();
+
+    void addHeapGrowth(Net net, long bytes);
+
+    long getHeapGrowth(Net net);
+
+    //with the heap probe on, samples the process heap the call starts with
+    void markHeapStart();
+
+    //heap in use now minus at markHeapStart, 0 without the probe
+    long getHeapSinceStart();
+
+private:
+    std::atomic<long> id;
+    std::atomic<long> liveBytes;
+    std::atomic<long> peakBytes;
+    std::atomic<long> largestMat;
+    std::atomic<long> heapGrowth[NETS];
+    std::atomic<bool> heapProbe;
+    long heapStart = 0;
+};
+
+//Scratch state of one detect call: Mats created through newMat and the float buffers of the
+//model tensors; it goes back to its pool after the call and is reused by the next one
+class Workspace {
+public:
+    enum FloatSlot {
+        INPUT_VALUES,
+        OUTPUT_DATA,
+        BATCH_DATA,
+        CHUNK_VALUES,
+        FLOAT_SLOTS
+    };
+
+    explicit Workspace(WorkspaceAllocator *allocator);
+
+    //empty Mat, whatever gets created in it is taken from the allocator
+    cv::Mat newMat();
+
+    cv::MatAllocator *getAllocator();
+
+    std::vector<float> &getFloats(FloatSlot slot);
+
+    //counts the float buffers that had to grow during the call
+    void countGrowth();
+
+    //meter of the call using this workspace, its own one unless leased for another call's box task
+    MemoryMeter *getMeter();
+
+    void attachMeter(MemoryMeter *meter);
+
+    void detachMeter();
+
+private:
+    //forwards to the shared allocator and counts the Mats of the current call in its meter
+    class MeteredAllocator : public cv::MatAllocator {
+    public:
+        explicit MeteredAllocator(WorkspaceAllocator *allocator);
+
+        cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                               MatAccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+
+        bool allocate(cv::UMatData *data, MatAccessFlag accessFlags,
+                      cv::UMatUsageFlags usageFlags) const override;
+
+        void deallocate(cv::UMatData *data) const override;
+
+        std::atomic<MemoryMeter *> meter;
+
+    private:
+        WorkspaceAllocator *allocator;
+    };
+
+    WorkspaceAllocator *allocator;
+    MeteredAllocator meteredAllocator;
+    MemoryMeter ownMeter;
+    std::vector<float> floats[FLOAT_SLOTS];
+    size_t capacities[FLOAT_SLOTS];
+    long floatBytes = 0;//float capacity already counted in the meter
+
+    void meterFloats();
+};
+
+class WorkspacePool {
+public:
+    WorkspacePool();
+
+    ~WorkspacePool();
+
+    //workspace metering into meter, or into a reset meter of its own when null
+    Workspace *acquire(MemoryMeter *meter = nullptr);
+
+    void release(Workspace *workspace);
+
+    void getStats(long &allocations, long &reuses, long &heldBytes);
+
+private:
+    //declared first: Mats of the workspaces must be gone before it
+    WorkspaceAllocator allocator;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Workspace>> workspaces;
+    std::vector<Workspace *> freeWorkspaces;
+};
+
+//Workspace borrowed for one scope
+class WorkspaceLease {
+public:
+    explicit WorkspaceLease(WorkspacePool &pool, MemoryMeter *meter = nullptr)
+            : pool(pool), workspace(pool.acquire(meter)) {}
+
+    ~WorkspaceLease() { pool.release(workspace); }
+
+    Workspace &get() { return *workspace; }
+
+private:
+    WorkspacePool &pool;
+    Workspace *workspace;
+};
+
+#endif //__OCR_WORKSPACE_H__
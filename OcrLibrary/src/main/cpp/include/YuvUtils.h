@@ -0,0 +1,34 @@
+#ifndef __OCR_YUV_UTILS_H__
+#define __OCR_YUV_UTILS_H__
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+//One YUV 4:2:0 frame as three planes, covers YUV_420_888 (I420 or semi-planar) and NV21/NV12:
+//for NV21 u = vu + 1, v = vu and uvPixelStride = 2
+struct YuvPlanes {
+    const uint8_t *y;
+    const uint8_t *u;
+    const uint8_t *v;
+    int width;
+    int height;
+    int yRowStride;
+    int uvRowStride;
+    int uvPixelStride;
+};
+
+//YUV_420_888 planes of an NV21 buffer (width * height Y, then interleaved VU)
+YuvPlanes getNv21Planes(const uint8_t *data, int width, int height);
+
+//false when a stride does not fit the width or a plane of the given bytes is too small for the frame;
+//the last row of a plane may end right after its pixels, as in camera buffers
+bool checkYuvPlanes(const YuvPlanes &yuv, int64_t ySize, int64_t uSize, int64_t vSize);
+
+//rotation: clockwise degrees (0, 90, 180 or 270) that make the crop upright
+bool isValidYuvRotation(int rotation);
+
+//Converts the crop of a frame to BGR (BT.601 video range) and rotates it into dst, in one pass over the
+//output; an empty crop means the whole frame
+void yuvToBgrMat(const YuvPlanes &yuv, cv::Rect crop, int rotation, cv::Mat &dst);
+
+#endif //__OCR_YUV_UTILS_H__
@@ -1,5 +1,6 @@
 #include "AngleNet.h"
 #include "OcrUtils.h"
+#include "Trace.h"
 #include <numeric>
 
 AngleNet::AngleNet() {}
@@ -39,6 +40,15 @@ void AngleNet::initModel(AAssetManager *mgr, const std::string &name) {
     free(dbModelData);
     inputNamesPtr = getInputNames(session);
     outputNamesPtr = getOutputNames(session);
+    profiler.setModel(mgr, name);
+}
+
+bool AngleNet::startProfiling(const std::string &prefix, int runs) {
+    return profiler.start(ortEnv, sessionOptions, prefix, runs);
+}
+
+std::vector<OpProfile> AngleNet::getOpProfiles() {
+    return profiler.getOpProfiles();
 }
 
 Angle scoreToAngle(const std::vector<float> &outputData) {
@@ -53,9 +63,10 @@ Angle scoreToAngle(const std::vector<float> &outputData) {
     return {maxIndex, maxScore};
 }
 
-Angle AngleNet::getAngle(cv::Mat &src) {
+Angle AngleNet::getAngle(cv::Mat &src, CancelToken *token, Workspace &workspace) {
 
-    std::vector<float> inputTensorValues = substractMeanNormalize(src, meanValues, normValues);
+    std::vector<float> &inputTensorValues = workspace.getFloats(Workspace::INPUT_VALUES);
+    substractMeanNormalize(src, meanValues, normValues, inputTensorValues);
 
     std::array<int64_t, 4> inputShape{1, src.channels(), src.rows, src.cols};
 
@@ -68,8 +79,15 @@ Angle AngleNet::getAngle(cv::Mat &src) {
     assert(inputTensor.IsTensor());
     std::vector<const char *> inputNames = {inputNamesPtr.data()->get()};
     std::vector<const char *> outputNames = {outputNamesPtr.data()->get()};
-    auto outputTensor = session->Run(Ort::RunOptions{nullptr}, inputNames.data(), &inputTensor,
-                                     inputNames.size(), outputNames.data(), outputNames.size());
+    double runTime = getCurrentTime();
+    MemoryMeter *meter = workspace.getMeter();
+    long heapBefore = meter->isHeapProbe() ? getHeapInUse() : 0;
+    OrtProfiler::Run profiledRun(profiler);
+    auto outputTensor = profiledRun.session(session)->Run(getRunOptions(token), inputNames.data(),
+                                                          &inputTensor, inputNames.size(),
+                                                          outputNames.data(), outputNames.size());
+    if (meter->isHeapProbe()) meter->addHeapGrowth(MemoryMeter::ANGLE_NET, getHeapInUse() - heapBefore);
+    addTraceSpan("angleNet.run", -1, runTime, getCurrentTime());
 
     assert(outputTensor.size() == 1 && outputTensor.front().IsTensor());
 
@@ -84,14 +102,31 @@ Angle AngleNet::getAngle(cv::Mat &src) {
 }
 
 std::vector<Angle> AngleNet::getAngles(std::vector<cv::Mat> &partImgs,
-                                       bool doAngle, bool mostAngle) {
+                                       bool doAngle, bool mostAngle, CancelToken *token,
+                                       Workspace &workspace) {
     int size = partImgs.size();
     std::vector<Angle> angles(size);
     if (doAngle) {
         for (int i = 0; i < size; ++i) {
+            //stopped: the remaining boxes are not scheduled
+            if (token != nullptr && token->isStopped()) {
+                angles.resize(i);
+                break;
+            }
             double startAngle = getCurrentTime();
-            auto angleImg = adjustTargetImg(partImgs[i], dstWidth, dstHeight);
-            Angle angle = getAngle(angleImg);
+            auto angleImg = adjustTargetImg(partImgs[i], dstWidth, dstHeight, workspace.getAllocator());
+            Angle angle;
+            try {
+                angle = getAngle(angleImg, token, workspace);
+            } catch (Ort::Exception &e) {
+                if (token == nullptr || !token->isStopped()) {
+                    LOGE("angleNet run failed: %s", e.what());
+                    throw;
+                }
+                LOGW("angleNet run stopped: %s", e.what());
+                angles.resize(i);
+                break;
+            }
             double endAngle = getCurrentTime();
             angle.time = endAngle - startAngle;
 
@@ -105,22 +140,26 @@ std::vector<Angle> AngleNet::getAngles(std::vector<cv::Mat> &partImgs,
     }
     //Most Possible AngleIndex
     if (doAngle && mostAngle) {
-        auto angleIndexes = getAngleIndexes(angles);
-        double sum = std::accumulate(angleIndexes.begin(), angleIndexes.end(), 0.0);
-        double halfPercent = angles.size() / 2.0f;
-        int mostAngleIndex;
-        if (sum < halfPercent) {//all angle set to 0
-            mostAngleIndex = 0;
-        } else {//all angle set to 1
-            mostAngleIndex = 1;
-        }
-        Logger("Set All Angle to mostAngleIndex(%d)", mostAngleIndex);
-        for (int i = 0; i < angles.size(); ++i) {
-            Angle angle = angles[i];
-            angle.index = mostAngleIndex;
-            angles.at(i) = angle;
-        }
+        setMostAngle(angles);
     }
 
     return angles;
+}
+
+void AngleNet::setMostAngle(std::vector<Angle> &angles) {
+    auto angleIndexes = getAngleIndexes(angles);
+    double sum = std::accumulate(angleIndexes.begin(), angleIndexes.end(), 0.0);
+    double halfPercent = angles.size() / 2.0f;
+    int mostAngleIndex;
+    if (sum < halfPercent) {//all angle set to 0
+        mostAngleIndex = 0;
+    } else {//all angle set to 1
+        mostAngleIndex = 1;
+    }
+    Logger("Set All Angle to mostAngleIndex(%d)", mostAngleIndex);
+    for (int i = 0; i < angles.size(); ++i) {
+        Angle angle = angles[i];
+        angle.index = mostAngleIndex;
+        angles.at(i) = angle;
+    }
 }
\ No newline at end of file
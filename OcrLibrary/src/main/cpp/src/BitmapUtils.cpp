@@ -104,4 +104,60 @@ void matToBitmap(JNIEnv *env, cv::Mat &src, jobject bitmap) {
         env->ThrowNew(je, "Unknown exception in JNI code {nMatToBitmap}");
         return;
     }
-}
\ No newline at end of file
+}
+
+Size getBitmapSize(JNIEnv *env, jobject bitmap) {
+    AndroidBitmapInfo info;
+    if (bitmap == NULL || AndroidBitmap_getInfo(env, bitmap, &info) < 0) return Size();
+    return Size(info.width, info.height);
+}
+
+LockedBitmap::LockedBitmap(JNIEnv *env, jobject bitmap, Size size) : env(env), bitmap(NULL) {
+    AndroidBitmapInfo info;
+    void *pixels = 0;
+    if (bitmap == NULL || size.area() <= 0 || AndroidBitmap_getInfo(env, bitmap, &info) < 0) return;
+    if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 || Size(info.width, info.height) != size) return;
+    if (AndroidBitmap_lockPixels(env, bitmap, &pixels) < 0) return;
+    this->bitmap = bitmap;
+    if (pixels) mat = Mat(info.height, info.width, CV_8UC4, pixels, info.stride);
+}
+
+LockedBitmap::~LockedBitmap() {
+    if (bitmap != NULL) AndroidBitmap_unlockPixels(env, bitmap);
+}
+
+void rgbaToBgrMat(const Mat &src, Mat &dst) {
+    cvtColor(src, dst, COLOR_RGBA2BGR);
+}
+
+void bitmapToBgrMat(JNIEnv *env, jobject bitmap, Mat &dst) {
+    AndroidBitmapInfo info;
+    void *pixels = 0;
+
+    try {
+        LOGI("nBitmapToBgrMat");
+        CV_Assert(AndroidBitmap_getInfo(env, bitmap, &info) >= 0);
+        CV_Assert(info.format == ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+                  info.format == ANDROID_BITMAP_FORMAT_RGB_565);
+        CV_Assert(AndroidBitmap_lockPixels(env, bitmap, &pixels) >= 0);
+        CV_Assert(pixels);
+        if (info.format == ANDROID_BITMAP_FORMAT_RGBA_8888) {
+            LOGI("nBitmapToBgrMat: RGBA_8888 -> CV_8UC3");
+            Mat tmp(info.height, info.width, CV_8UC4, pixels, info.stride);
+            cvtColor(tmp, dst, COLOR_RGBA2BGR);
+        } else {
+            // info.format == ANDROID_BITMAP_FORMAT_RGB_565
+            LOGI("nBitmapToBgrMat: RGB_565 -> CV_8UC3");
+            Mat tmp(info.height, info.width, CV_8UC2, pixels, info.stride);
+            cvtColor(tmp, dst, COLOR_BGR5652BGR);
+        }
+        AndroidBitmap_unlockPixels(env, bitmap);
+        return;
+    } catch (...) {
+        AndroidBitmap_unlockPixels(env, bitmap);
+        LOGE("nBitmapToBgrMat caught unknown exception (...)");
+        jclass je = env->FindClass("java/lang/Exception");
+        env->ThrowNew(je, "Unknown exception in JNI code {nBitmapToBgrMat}");
+        return;
+    }
+}
@@ -0,0 +1,42 @@
+#include "CancelToken.h"
+#include "OcrUtils.h"
+
+CancelToken::CancelToken() {
+    cancelled = false;
+    terminated = false;
+}
+
+CancelToken::~CancelToken() {}
+
+void CancelToken::cancel() {
+    cancelled = true;
+    terminate();
+}
+
+void CancelToken::setDeadline(double time) {
+    deadline = time;
+}
+
+void CancelToken::terminate() {
+    if (terminated.exchange(true)) return;
+    runOptions.SetTerminate();
+}
+
+bool CancelToken::isCancelled() {
+    return cancelled;
+}
+
+bool CancelToken::isStopped() {
+    if (terminated) return true;
+    return deadline > 0 && getCurrentTime() >= deadline;
+}
+
+Ort::RunOptions &CancelToken::getRunOptions() {
+    return runOptions;
+}
+
+Ort::RunOptions &getRunOptions(CancelToken *token) {
+    static Ort::RunOptions emptyRunOptions{nullptr};
+    if (token == nullptr) return emptyRunOptions;
+    return token->getRunOptions();
+}
@@ -1,6 +1,10 @@
 #include "CrnnNet.h"
 #include "OcrUtils.h"
+#include "Trace.h"
 #include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <map>
 
 CrnnNet::CrnnNet() {}
 
@@ -32,29 +36,8 @@ void CrnnNet::setNumThread(int numOfThread) {
 }
 
 char *readKeysFromAssets(AAssetManager *mgr, const std::string &keysName) {
-    //LOGI("readKeysFromAssets start...");
-    if (mgr == NULL) {
-        LOGE(" %s", "AAssetManager==NULL");
-        return NULL;
-    }
-    char *buffer;
-    /*获取文件名并打开*/
-    AAsset *asset = AAssetManager_open(mgr, keysName.c_str(), AASSET_MODE_UNKNOWN);
-    if (asset == NULL) {
-        LOGE(" %s", "asset==NULL");
-        return NULL;
-    }
-    /*获取文件大小*/
-    off_t bufferSize = AAsset_getLength(asset);
-    //LOGI("file size : %d", bufferSize);
-    buffer = (char *) malloc(bufferSize + 1);
-    buffer[bufferSize] = 0;
-    int numBytesRead = AAsset_read(asset, buffer, bufferSize);
-    //LOGI("readKeysFromAssets: %d", numBytesRead);
-    /*关闭文件*/
-    AAsset_close(asset);
-    //LOGI("readKeysFromAssets exit...");
-    return buffer;
+    int size = 0;
+    return (char *) getModelDataFromAssets(mgr, keysName.c_str(), size);
 }
 
 void CrnnNet::initModel(AAssetManager *mgr, const std::string &name, const std::string &keysName) {
@@ -65,6 +48,7 @@ void CrnnNet::initModel(AAssetManager *mgr, const std::string &name, const std::
     free(dbModelData);
     inputNamesPtr = getInputNames(session);
     outputNamesPtr = getOutputNames(session);
+    profiler.setModel(mgr, name);
 
     //load keys
     char *buffer = readKeysFromAssets(mgr, keysName);
@@ -83,6 +67,17 @@ void CrnnNet::initModel(AAssetManager *mgr, const std::string &name, const std::
                 "#"); // blank char for ctc
     keys.emplace_back(" ");
     LOGI("keys size(%d)", keys.size());
+    std::lock_guard<std::mutex> lock(compiledMutex);
+    charsetCache.clear();
+    patternCache.clear();
+}
+
+bool CrnnNet::startProfiling(const std::string &prefix, int runs) {
+    return profiler.start(ortEnv, sessionOptions, prefix, runs);
+}
+
+std::vector<OpProfile> CrnnNet::getOpProfiles() {
+    return profiler.getOpProfiles();
 }
 
 template<class ForwardIterator>
@@ -90,7 +85,41 @@ inline static size_t argmax(ForwardIterator first, ForwardIterator last) {
     return std::distance(first, std::max_element(first, last));
 }
 
-TextLine CrnnNet::scoreToTextLine(const std::vector<float> &outputData, int h, int w) {
+std::shared_ptr<const std::vector<int>> CrnnNet::getCharsetIndexes(const std::string &allowedChars) {
+    {
+        std::lock_guard<std::mutex> lock(compiledMutex);
+        auto it = charsetCache.find(allowedChars);
+        if (it != charsetCache.end()) return it->second;
+    }
+    auto charsetIndexes = std::make_shared<const std::vector<int>>(buildCharsetIndexes(allowedChars));
+    std::lock_guard<std::mutex> lock(compiledMutex);
+    if (charsetCache.size() >= maxCompiled) charsetCache.clear();
+    //a concurrent call may have built it first, both results are equal
+    return charsetCache.emplace(allowedChars, charsetIndexes).first->second;
+}
+
+std::vector<int> CrnnNet::buildCharsetIndexes(const std::string &allowedChars) {
+    std::vector<int> charsetIndexes;
+    if (allowedChars.empty()) return charsetIndexes;
+    std::vector<std::string> chars = splitUtf8(allowedChars);
+    for (auto &c: chars) {
+        //index 0 is the ctc blank, never a valid char
+        auto it = std::find(keys.begin() + 1, keys.end(), c);
+        if (it == keys.end()) {
+            LOGW("allowed char(%s) not in keys", c.c_str());
+            continue;
+        }
+        int index = int(std::distance(keys.begin(), it));
+        if (std::find(charsetIndexes.begin(), charsetIndexes.end(), index) == charsetIndexes.end()) {
+            charsetIndexes.emplace_back(index);
+        }
+    }
+    std::sort(charsetIndexes.begin(), charsetIndexes.end());
+    return charsetIndexes;
+}
+
+TextLine scoreToTextLine(const std::vector<float> &outputData, int h, int w,
+                         const std::vector<std::string> &keys, const std::vector<int> &charsetIndexes) {
     auto keySize = keys.size();
     auto dataSize = outputData.size();
     std::string strRes;
@@ -105,8 +134,21 @@ TextLine CrnnNet::scoreToTextLine(const std::vector<float> &outputData, int h, i
         if (stop > dataSize - 1) {
             stop = (i + 1) * w - 1;
         }
-        maxIndex = int(argmax(&outputData[start], &outputData[stop]));
-        maxValue = float(*std::max_element(&outputData[start], &outputData[stop]));
+        if (charsetIndexes.empty()) {
+            maxIndex = int(argmax(&outputData[start], &outputData[stop]));
+            maxValue = float(*std::max_element(&outputData[start], &outputData[stop]));
+        } else {
+            //only blank and allowed chars take part in argmax
+            maxIndex = 0;
+            maxValue = outputData[start];
+            for (int index: charsetIndexes) {
+                if (start + index >= stop) break;
+                if (outputData[start + index] > maxValue) {
+                    maxValue = outputData[start + index];
+                    maxIndex = index;
+                }
+            }
+        }
 
         if (maxIndex > 0 && maxIndex < keySize && (!(i > 0 && maxIndex == lastIndex))) {
             scores.emplace_back(maxValue);
@@ -117,17 +159,197 @@ TextLine CrnnNet::scoreToTextLine(const std::vector<float> &outputData, int h, i
     return {strRes, scores};
 }
 
-TextLine CrnnNet::getTextLine(cv::Mat &src) {
-    float scale = (float) dstHeight / (float) src.rows;
-    int dstWidth = int((float) src.cols * scale);
+TextLine CrnnNet::scoreToTextLine(const std::vector<float> &outputData, int h, int w,
+                                  const std::vector<int> &charsetIndexes) {
+    return ::scoreToTextLine(outputData, h, w, keys, charsetIndexes);
+}
 
-    cv::Mat srcResize;
-    resize(src, srcResize, cv::Size(dstWidth, dstHeight));
+std::shared_ptr<const TextPattern> CrnnNet::getTextPattern(const std::string &pattern, bool luhnCheck) {
+    std::pair<std::string, bool> key(pattern, luhnCheck);
+    {
+        std::lock_guard<std::mutex> lock(compiledMutex);
+        auto it = patternCache.find(key);
+        if (it != patternCache.end()) return it->second;
+    }
+    //compiled outside the lock, the dfa construction is the costly part
+    auto textPattern = std::make_shared<TextPattern>();
+    if (!pattern.empty() && !textPattern->compile(pattern, keys)) {
+        LOGW("invalid text pattern(%s)", pattern.c_str());
+    }
+    textPattern->setLuhnCheck(luhnCheck);
+    std::lock_guard<std::mutex> lock(compiledMutex);
+    if (patternCache.size() >= maxCompiled) patternCache.clear();
+    return patternCache.emplace(key, std::move(textPattern)).first->second;
+}
+
+inline static float logSumExp(float a, float b) {
+    if (a == -INFINITY) return b;
+    if (b == -INFINITY) return a;
+    float m = (std::max)(a, b);
+    return m + std::log1p(std::exp(-std::fabs(a - b)));
+}
+
+struct CtcBeam {
+    std::vector<int> prefix;
+    std::vector<float> scores;
+    int state;
+    float blankProb;//log prob of paths ending in blank
+    float charProb;//log prob of paths ending in prefix.back()
+
+    float total() const { return logSumExp(blankProb, charProb); }
+};
+
+//ctc prefix beam search, extensions are restricted to the transitions of textPattern,
+//returns false when no beam ends in an accepting state that also passes textPattern.check
+bool CrnnNet::beamSearchToTextLine(const std::vector<float> &outputData, int h, int w,
+                                   const TextPattern &textPattern, TextLine &textLine) {
+    const float minProb = 1e-4f;
+    const float blankSkipProb = 0.999f;
+    int keySize = (std::min)(int(keys.size()), w);
+
+    std::vector<CtcBeam> beams;
+    beams.emplace_back(CtcBeam{{}, {}, textPattern.startState(), 0.f, -INFINITY});
+
+    for (int t = 0; t < h; ++t) {
+        const float *probs = &outputData[t * w];
+        float blankLog = std::log((std::max)(probs[0], 1e-30f));
+        std::map<std::vector<int>, CtcBeam> nextBeams;
+
+        for (auto &beam: beams) {
+            float total = beam.total();
+            //stay on the same prefix: emit blank, or repeat the last char
+            auto it = nextBeams.find(beam.prefix);
+            if (it == nextBeams.end()) {
+                it = nextBeams.emplace(beam.prefix, CtcBeam{beam.prefix, beam.scores, beam.state,
+                                                            -INFINITY, -INFINITY}).first;
+            }
+            it->second.blankProb = logSumExp(it->second.blankProb, total + blankLog);
+            if (!beam.prefix.empty()) {
+                int last = beam.prefix.back();
+                float p = probs[last];
+                if (p > minProb) {
+                    it->second.charProb = logSumExp(it->second.charProb, beam.charProb + std::log(p));
+                    if (p > it->second.scores.back()) it->second.scores.back() = p;
+                }
+            }
+            if (probs[0] > blankSkipProb) continue;
+
+            //extend the prefix with every char the pattern allows next
+            for (auto &trans: textPattern.transitions(beam.state)) {
+                int index = trans.first;
+                if (index >= keySize) continue;
+                float p = probs[index];
+                if (p < minProb) continue;
+                //a repeated char needs a blank in between
+                float from = (!beam.prefix.empty() && beam.prefix.back() == index) ? beam.blankProb : total;
+                if (from == -INFINITY) continue;
+                std::vector<int> prefix = beam.prefix;
+                prefix.emplace_back(index);
+                auto next = nextBeams.find(prefix);
+                if (next == nextBeams.end()) {
+                    std::vector<float> scores = beam.scores;
+                    scores.emplace_back(p);
+                    next = nextBeams.emplace(prefix, CtcBeam{prefix, scores, trans.second,
+                                                             -INFINITY, -INFINITY}).first;
+                }
+                next->second.charProb = logSumExp(next->second.charProb, from + std::log(p));
+            }
+        }
+
+        beams.clear();
+        for (auto &item: nextBeams) {
+            beams.emplace_back(item.second);
+        }
+        int keep = (std::min)(int(beams.size()), beamWidth);
+        std::partial_sort(beams.begin(), beams.begin() + keep, beams.end(),
+                          [](const CtcBeam &a, const CtcBeam &b) { return a.total() > b.total(); });
+        beams.resize(keep);
+    }
+
+    for (auto &beam: beams) {
+        if (!textPattern.isAccept(beam.state)) continue;
+        std::string strRes;
+        for (int index: beam.prefix) {
+            strRes.append(keys[index]);
+        }
+        if (!textPattern.check(strRes)) continue;
+        textLine.text = strRes;
+        textLine.charScores = beam.scores;
+        return true;
+    }
+    return false;
+}
+
+void CrnnNet::setMaxWidth(int width) {
+    //a chunk must be wide enough to keep something besides the two overlaps
+    maxWidth = width <= 0 ? 0 : (std::max)(width, 4 * chunkOverlap);
+}
+
+void CrnnNet::setWidthQuantum(int quantum) {
+    widthQuantum = (std::max)(quantum, 0);
+}
+
+void CrnnNet::addShape(int rawWidth, int runWidth) {
+    std::lock_guard<std::mutex> lock(shapeMutex);
+    rawWidths.insert(rawWidth);
+    runWidths.insert(runWidth);
+}
+
+void CrnnNet::getShapeStats(int &rawShapes, int &runShapes) {
+    std::lock_guard<std::mutex> lock(shapeMutex);
+    rawShapes = rawWidths.size();
+    runShapes = runWidths.size();
+}
+
+void CrnnNet::resetShapeStats() {
+    std::lock_guard<std::mutex> lock(shapeMutex);
+    rawWidths.clear();
+    runWidths.clear();
+}
 
-    std::vector<float> inputTensorValues = substractMeanNormalize(srcResize, meanValues,
-                                                                  normValues);
+int CrnnNet::getCacheSize() {
+    return cacheSize;
+}
+
+void CrnnNet::setCacheSize(int size) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cacheSize = (std::max)(size, 0);
+    while (cacheList.size() > cacheSize) {
+        cacheMap.erase(cacheList.back().first);
+        cacheList.pop_back();
+    }
+}
+
+bool CrnnNet::getCachedTextLine(uint64_t key, TextLine &textLine) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cacheMap.find(key);
+    if (it == cacheMap.end()) return false;
+    cacheList.splice(cacheList.begin(), cacheList, it->second);
+    textLine = it->second->second;
+    return true;
+}
+
+void CrnnNet::putCachedTextLine(uint64_t key, const TextLine &textLine) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cacheSize <= 0) return;
+    auto it = cacheMap.find(key);
+    if (it != cacheMap.end()) {
+        it->second->second = textLine;
+        cacheList.splice(cacheList.begin(), cacheList, it->second);
+        return;
+    }
+    cacheList.emplace_front(key, textLine);
+    cacheMap[key] = cacheList.begin();
+    if (cacheList.size() > cacheSize) {
+        cacheMap.erase(cacheList.back().first);
+        cacheList.pop_back();
+    }
+}
 
-    std::array<int64_t, 4> inputShape{1, srcResize.channels(), srcResize.rows, srcResize.cols};
+void CrnnNet::getOutputData(std::vector<float> &inputTensorValues, int batch, int width,
+                            std::vector<int64_t> &outputShape, std::vector<float> &outputData,
+                            CancelToken *token, MemoryMeter *meter) {
+    std::array<int64_t, 4> inputShape{batch, 3, dstHeight, width};
 
     auto memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
 
@@ -138,28 +360,183 @@ TextLine CrnnNet::getTextLine(cv::Mat &src) {
     assert(inputTensor.IsTensor());
     std::vector<const char *> inputNames = {inputNamesPtr.data()->get()};
     std::vector<const char *> outputNames = {outputNamesPtr.data()->get()};
-    auto outputTensor = session->Run(Ort::RunOptions{nullptr}, inputNames.data(), &inputTensor,
-                                     inputNames.size(), outputNames.data(), outputNames.size());
+    double runTime = getCurrentTime();
+    long heapBefore = meter->isHeapProbe() ? getHeapInUse() : 0;
+    OrtProfiler::Run profiledRun(profiler);
+    auto outputTensor = profiledRun.session(session)->Run(getRunOptions(token), inputNames.data(),
+                                                          &inputTensor, inputNames.size(),
+                                                          outputNames.data(), outputNames.size());
+    if (meter->isHeapProbe()) meter->addHeapGrowth(MemoryMeter::CRNN_NET, getHeapInUse() - heapBefore);
+    addTraceSpan("crnnNet.run", width, runTime, getCurrentTime());
 
     assert(outputTensor.size() == 1 && outputTensor.front().IsTensor());
 
-    std::vector<int64_t> outputShape = outputTensor[0].GetTensorTypeAndShapeInfo().GetShape();
+    outputShape = outputTensor[0].GetTensorTypeAndShapeInfo().GetShape();
 
     int64_t outputCount = std::accumulate(outputShape.begin(), outputShape.end(), 1,
                                           std::multiplies<int64_t>());
 
     float *floatArray = outputTensor.front().GetTensorMutableData<float>();
-    std::vector<float> outputData(floatArray, floatArray + outputCount);
-    return scoreToTextLine(outputData, outputShape[1], outputShape[2]);
+    outputData.assign(floatArray, floatArray + outputCount);
+}
+
+//Splits a too wide line into maxWidth chunks overlapping by chunkOverlap, runs them in batches and
+//stitches the score rows at the middle of every overlap, so the ctc decoder sees one continuous line
+void CrnnNet::getChunkedOutputData(cv::Mat &srcResize, int windowWidth, int &steps, int &classes,
+                                   std::vector<float> &outputData, CancelToken *token,
+                                   Workspace &workspace) {
+    int width = srcResize.cols;
+    int stride = windowWidth - chunkOverlap;
+    std::vector<int> chunkStarts;
+    for (int x = 0;; x += stride) {
+        chunkStarts.emplace_back(x);
+        if (x + windowWidth >= width) break;
+    }
+    int chunkCount = chunkStarts.size();
+
+    outputData.clear();
+    steps = 0;
+    classes = 0;
+    std::vector<float> &inputTensorValues = workspace.getFloats(Workspace::INPUT_VALUES);
+    std::vector<float> &batchData = workspace.getFloats(Workspace::BATCH_DATA);
+    std::vector<float> &chunkValues = workspace.getFloats(Workspace::CHUNK_VALUES);
+    cv::Mat chunk = workspace.newMat();
+    for (int batchStart = 0; batchStart < chunkCount; batchStart += chunkBatch) {
+        int batch = (std::min)(chunkBatch, chunkCount - batchStart);
+        inputTensorValues.clear();
+        for (int i = 0; i < batch; ++i) {
+            int x = chunkStarts[batchStart + i];
+            int chunkWidth = (std::min)(windowWidth, width - x);
+            //the last chunk is padded with white so all chunks share one shape
+            chunk.create(dstHeight, windowWidth, CV_8UC3);
+            chunk.setTo(cv::Scalar(255, 255, 255));
+            srcResize(cv::Rect(x, 0, chunkWidth, dstHeight)).copyTo(chunk(cv::Rect(0, 0, chunkWidth, dstHeight)));
+            addShape(chunkWidth, windowWidth);
+            substractMeanNormalize(chunk, meanValues, normValues, chunkValues);
+            inputTensorValues.insert(inputTensorValues.end(), chunkValues.begin(), chunkValues.end());
+        }
+
+        std::vector<int64_t> outputShape;
+        getOutputData(inputTensorValues, batch, windowWidth, outputShape, batchData, token, workspace.getMeter());
+        int chunkSteps = outputShape[1];
+        classes = outputShape[2];
+        float stepWidth = (float) windowWidth / (float) chunkSteps;
+
+        for (int i = 0; i < batch; ++i) {
+            int chunkIndex = batchStart + i;
+            int x = chunkStarts[chunkIndex];
+            int keepStart = chunkIndex == 0 ? x : x + chunkOverlap / 2;
+            int keepEnd = chunkIndex == chunkCount - 1 ? width : chunkStarts[chunkIndex + 1] + chunkOverlap / 2;
+            int stepStart = int(std::round((float) (keepStart - x) / stepWidth));
+            int stepEnd = (std::min)(int(std::round((float) (keepEnd - x) / stepWidth)), chunkSteps);
+            if (stepEnd <= stepStart) continue;
+            auto first = batchData.begin() + (size_t(i) * chunkSteps + stepStart) * classes;
+            auto last = batchData.begin() + (size_t(i) * chunkSteps + stepEnd) * classes;
+            outputData.insert(outputData.end(), first, last);
+            steps += stepEnd - stepStart;
+        }
+    }
+}
+
+int CrnnNet::getInputWidth(const cv::Mat &src) {
+    float scale = (float) dstHeight / (float) src.rows;
+    return int((float) src.cols * scale);
+}
+
+TextLine CrnnNet::getTextLine(cv::Mat &src, const std::vector<int> &charsetIndexes,
+                               const TextPattern &textPattern, uint64_t decodeKey, CancelToken *token,
+                               Workspace &workspace) {
+    int dstWidth = getInputWidth(src);
+    //settings may change from another thread, one call sees one value
+    int windowWidth = maxWidth;
+    int quantum = widthQuantum;
+    bool useCache = cacheSize > 0;
+
+    cv::Mat srcResize = workspace.newMat();
+    resize(src, srcResize, cv::Size(dstWidth, dstHeight));
+
+    uint64_t cacheKey = 0;
+    if (useCache) {
+        cacheKey = getMatFingerprint(srcResize) ^ decodeKey;
+        TextLine textLine;
+        if (getCachedTextLine(cacheKey, textLine)) {
+            textLine.cached = true;
+            return textLine;
+        }
+    }
+
+    std::vector<float> &outputData = workspace.getFloats(Workspace::OUTPUT_DATA);
+    int steps, classes;
+    if (windowWidth > 0 && dstWidth > windowWidth) {
+        getChunkedOutputData(srcResize, windowWidth, steps, classes, outputData, token, workspace);
+    } else {
+        //round the width up to a multiple of widthQuantum so ort sees few distinct shapes
+        int runWidth = dstWidth;
+        if (quantum > 0) {
+            runWidth = (dstWidth + quantum - 1) / quantum * quantum;
+        }
+        addShape(dstWidth, runWidth);
+        cv::Mat runImg = srcResize;
+        if (runWidth > dstWidth) {
+            runImg = workspace.newMat();
+            runImg.create(dstHeight, runWidth, CV_8UC3);
+            runImg.setTo(cv::Scalar(255, 255, 255));
+            srcResize.copyTo(runImg(cv::Rect(0, 0, dstWidth, dstHeight)));
+        }
+        std::vector<float> &inputTensorValues = workspace.getFloats(Workspace::INPUT_VALUES);
+        substractMeanNormalize(runImg, meanValues, normValues, inputTensorValues);
+        std::vector<int64_t> outputShape;
+        getOutputData(inputTensorValues, 1, runWidth, outputShape, outputData, token, workspace.getMeter());
+        steps = outputShape[1];
+        classes = outputShape[2];
+        //drop the timesteps that only saw padding
+        if (runWidth > dstWidth) {
+            int validSteps = (dstWidth * steps + runWidth - 1) / runWidth;
+            steps = (std::min)(validSteps, steps);
+            outputData.resize(size_t(steps) * classes);
+        }
+    }
+
+    TextLine textLine;
+    textLine.cached = false;
+    if (textPattern.empty() || !beamSearchToTextLine(outputData, steps, classes, textPattern, textLine)) {
+        textLine = scoreToTextLine(outputData, steps, classes, charsetIndexes);
+    }
+    if (useCache) putCachedTextLine(cacheKey, textLine);
+    return textLine;
 }
 
-std::vector<TextLine> CrnnNet::getTextLines(std::vector<cv::Mat> &partImg) {
+std::vector<TextLine> CrnnNet::getTextLines(std::vector<cv::Mat> &partImg,
+                                           const std::vector<int> &charsetIndexes,
+                                           const TextPattern &textPattern, CancelToken *token,
+                                           Workspace &workspace) {
+    //decode options change the result, so they are part of the cache key
+    uint64_t decodeKey = std::hash<std::string>()(textPattern.getPattern()) * 31 + textPattern.getLuhnCheck();
+    for (int index: charsetIndexes) {
+        decodeKey = decodeKey * 31 + index;
+    }
     int size = partImg.size();
     std::vector<TextLine> textLines(size);
     for (int i = 0; i < size; ++i) {
+        //stopped: return the lines recognized so far
+        if (token != nullptr && token->isStopped()) {
+            textLines.resize(i);
+            break;
+        }
         //getTextLine
         double startCrnnTime = getCurrentTime();
-        TextLine textLine = getTextLine(partImg[i]);
+        TextLine textLine;
+        try {
+            textLine = getTextLine(partImg[i], charsetIndexes, textPattern, decodeKey, token, workspace);
+        } catch (Ort::Exception &e) {
+            if (token == nullptr || !token->isStopped()) {
+                LOGE("crnnNet run failed: %s", e.what());
+                throw;
+            }
+            LOGW("crnnNet run stopped: %s", e.what());
+            textLines.resize(i);
+            break;
+        }
         double endCrnnTime = getCurrentTime();
         textLine.time = endCrnnTime - startCrnnTime;
         textLines[i] = textLine;
@@ -1,5 +1,7 @@
 #include "DbNet.h"
 #include "OcrUtils.h"
+#include "Trace.h"
+#include "PerfCounters.h"
 #include <numeric>
 
 DbNet::DbNet() {}
@@ -38,10 +40,20 @@ void DbNet::initModel(AAssetManager *mgr, const std::string &name) {
     free(dbModelData);
     inputNamesPtr = getInputNames(session);
     outputNamesPtr = getOutputNames(session);
+    profiler.setModel(mgr, name);
 }
 
+bool DbNet::startProfiling(const std::string &prefix, int runs) {
+    return profiler.start(ortEnv, sessionOptions, prefix, runs);
+}
+
+std::vector<OpProfile> DbNet::getOpProfiles() {
+    return profiler.getOpProfiles();
+}
+
+//s maps the src area of the tensor, which starts at offset, to src
 std::vector<TextBox> findRsBoxes(const cv::Mat &predMat, const cv::Mat &dilateMat, ScaleParam &s,
-                                 const float boxScoreThresh, const float unClipRatio) {
+                                 const cv::Point2f &offset, const float boxScoreThresh, const float unClipRatio) {
     const int longSideThresh = 3;//minBox 长边门限
     const int maxCandidates = 1000;
 
@@ -86,8 +98,8 @@ std::vector<TextBox> findRsBoxes(const cv::Mat &predMat, const cv::Mat &dilateMa
         std::vector<cv::Point> intClipMinBoxes;
 
         for (int p = 0; p < clipMinBoxes.size(); p++) {
-            float x = clipMinBoxes[p].x / s.ratioWidth;
-            float y = clipMinBoxes[p].y / s.ratioHeight;
+            float x = (clipMinBoxes[p].x - offset.x) / s.ratioWidth;
+            float y = (clipMinBoxes[p].y - offset.y) / s.ratioHeight;
             int ptX = (std::min)((std::max)(int(x), 0), s.srcWidth - 1);
             int ptY = (std::min)((std::max)(int(y), 0), s.srcHeight - 1);
             cv::Point point{ptX, ptY};
@@ -101,13 +113,24 @@ std::vector<TextBox> findRsBoxes(const cv::Mat &predMat, const cv::Mat &dilateMa
 
 std::vector<TextBox>
 DbNet::getTextBoxes(cv::Mat &src, ScaleParam &s, float boxScoreThresh, float boxThresh,
-                    float unClipRatio) {
-    cv::Mat srcResize;
-    resize(src, srcResize, cv::Size(s.dstWidth, s.dstHeight));
-    std::vector<float> inputTensorValues = substractMeanNormalize(srcResize, meanValues,
-                                                                  normValues);
-
-    std::array<int64_t, 4> inputShape{1, srcResize.channels(), srcResize.rows, srcResize.cols};
+                    float unClipRatio, CancelToken *token, Workspace &workspace, StageTimes &times,
+                    StageCounters &counters) {
+    double startTime = getCurrentTime();
+    PerfSample startSample = readPerfCounters();
+    //virtual padding: src goes into the center of the tensor, the border is only written as white values
+    int left = int(std::round((float) s.padding * s.ratioWidth));
+    int top = int(std::round((float) s.padding * s.ratioHeight));
+    int resizeWidth = (std::max)(s.dstWidth - 2 * left, 1);
+    int resizeHeight = (std::max)(s.dstHeight - 2 * top, 1);
+    ScaleParam srcScale{src.cols, src.rows, resizeWidth, resizeHeight,
+                        (float) resizeWidth / (float) src.cols, (float) resizeHeight / (float) src.rows};
+    cv::Mat srcResize = workspace.newMat();
+    resize(src, srcResize, cv::Size(resizeWidth, resizeHeight));
+    std::vector<float> &inputTensorValues = workspace.getFloats(Workspace::INPUT_VALUES);
+    substractMeanNormalize(srcResize, left, top, s.dstWidth, s.dstHeight, meanValues, normValues,
+                           inputTensorValues);
+
+    std::array<int64_t, 4> inputShape{1, srcResize.channels(), s.dstHeight, s.dstWidth};
 
     auto memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
 
@@ -118,41 +141,71 @@ DbNet::getTextBoxes(cv::Mat &src, ScaleParam &s, float boxScoreThresh, float box
     assert(inputTensor.IsTensor());
     std::vector<const char *> inputNames = {inputNamesPtr.data()->get()};
     std::vector<const char *> outputNames = {outputNamesPtr.data()->get()};
-    auto outputTensor = session->Run(Ort::RunOptions{nullptr}, inputNames.data(), &inputTensor,
-                                     inputNames.size(), outputNames.data(), outputNames.size());
+    OrtProfiler::Run profiledRun(profiler);
+    std::vector<Ort::Value> outputTensor;
+    double runTime = getCurrentTime();
+    times.dbPreprocess = runTime - startTime;
+    PerfSample runSample = readPerfCounters();
+    MemoryMeter *meter = workspace.getMeter();
+    long heapBefore = meter->isHeapProbe() ? getHeapInUse() : 0;
+    try {
+        outputTensor = profiledRun.session(session)->Run(getRunOptions(token), inputNames.data(),
+                                                         &inputTensor, inputNames.size(),
+                                                         outputNames.data(), outputNames.size());
+    } catch (Ort::Exception &e) {
+        //only a stopped token terminates a run on purpose, anything else is a real failure
+        if (token == nullptr || !token->isStopped()) {
+            LOGE("dbNet run failed: %s", e.what());
+            throw;
+        }
+        LOGW("dbNet run stopped: %s", e.what());
+        return {};
+    }
+    if (meter->isHeapProbe()) meter->addHeapGrowth(MemoryMeter::DB_NET, getHeapInUse() - heapBefore);
+    double postTime = getCurrentTime();
+    times.dbInference = postTime - runTime;
+    PerfSample postSample = readPerfCounters();
+    addTraceSpan("dbNet.preprocess", -1, startTime, runTime);
+    addTraceSpan("dbNet.run", -1, runTime, postTime);
     assert(outputTensor.size() == 1 && outputTensor.front().IsTensor());
     std::vector<int64_t> outputShape = outputTensor[0].GetTensorTypeAndShapeInfo().GetShape();
-    int64_t outputCount = std::accumulate(outputShape.begin(), outputShape.end(), 1,
-                                          std::multiplies<int64_t>());
     float *floatArray = outputTensor.front().GetTensorMutableData<float>();
-    std::vector<float> outputData(floatArray, floatArray + outputCount);
 
     //-----Data preparation-----
     int outHeight = outputShape[2];
     int outWidth = outputShape[3];
     int area = outHeight * outWidth;
 
-    std::vector<float> predData(area, 0.0);
-    std::vector<unsigned char> cbufData(area, ' ');
+    //the output tensor lives until return, so it is used in place
+    cv::Mat predMat(outHeight, outWidth, CV_32F, floatArray);
+    cv::Mat cBufMat = workspace.newMat();
+    cBufMat.create(outHeight, outWidth, CV_8UC1);
+    unsigned char *cbufData = cBufMat.ptr<unsigned char>();
 
     for (int i = 0; i < area; i++) {
-        predData[i] = float(outputData[i]);
-        cbufData[i] = (unsigned char) ((outputData[i]) * 255);
+        cbufData[i] = (unsigned char) (floatArray[i] * 255);
     }
 
-    cv::Mat predMat(outHeight, outWidth, CV_32F, (float *) predData.data());
-    cv::Mat cBufMat(outHeight, outWidth, CV_8UC1, (unsigned char *) cbufData.data());
-
     //-----boxThresh-----
     const double maxValue = 255;
     const double threshold = boxThresh * 255;
-    cv::Mat thresholdMat;
+    cv::Mat thresholdMat = workspace.newMat();
     cv::threshold(cBufMat, thresholdMat, threshold, maxValue, cv::THRESH_BINARY);
 
     //-----dilate-----
-    cv::Mat dilateMat;
+    cv::Mat dilateMat = workspace.newMat();
     cv::Mat dilateElement = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2));
     cv::dilate(thresholdMat, dilateMat, dilateElement);
 
-    return findRsBoxes(predMat, dilateMat, s, boxScoreThresh, unClipRatio);
+    std::vector<TextBox> rsBoxes = findRsBoxes(predMat, dilateMat, srcScale, cv::Point2f(left, top),
+                                               boxScoreThresh, unClipRatio);
+    double endTime = getCurrentTime();
+    times.dbPostprocess = endTime - postTime;
+    if (isPerfCountersEnabled()) {
+        addPerfSample(counters.dbPreprocess, startSample, runSample);
+        addPerfSample(counters.dbInference, runSample, postSample);
+        addPerfSample(counters.dbPostprocess, postSample, readPerfCounters());
+    }
+    addTraceSpan("dbNet.postprocess", rsBoxes.size(), postTime, endTime);
+    return rsBoxes;
 }
@@ -0,0 +1,42 @@
+#include "OcrAsyncTask.h"
+#include "OcrLite.h"
+#include "OcrUtils.h"
+
+OcrAsyncTask::OcrAsyncTask(OcrLite *ocrLite, OcrFrame frame, double timeout) {
+    cancelToken = std::make_shared<CancelToken>();
+    if (timeout > 0) {
+        deadline = getCurrentTime() + timeout;
+        cancelToken->setDeadline(deadline);
+    }
+    frame.cancelToken = cancelToken;
+    //the frame owns its workspace, so it is moved into the task
+    future = std::async(std::launch::async, [ocrLite, frame = std::move(frame)]() mutable {
+        return ocrLite->detect(frame);
+    });
+}
+
+OcrAsyncTask::~OcrAsyncTask() {
+    if (future.valid()) {
+        cancelToken->cancel();
+        future.wait();
+    }
+}
+
+void OcrAsyncTask::cancel() {
+    cancelToken->cancel();
+}
+
+bool OcrAsyncTask::get(OcrResult &result) {
+    std::lock_guard<std::mutex> lock(futureMutex);
+    if (!future.valid()) return false;
+    if (deadline > 0) {
+        double remain = deadline - getCurrentTime();
+        auto status = future.wait_for(std::chrono::microseconds(int64_t((std::max)(remain, 0.0) * 1000)));
+        if (status != std::future_status::ready) {
+            Logger("detect deadline reached, terminate");
+            cancelToken->terminate();
+        }
+    }
+    result = future.get();
+    return !cancelToken->isCancelled();
+}
@@ -1,34 +1,89 @@
-#include <android/asset_manager.h>
-#include <android/asset_manager_jni.h>
 #include "OcrLite.h"
 #include "OcrUtils.h"
+#include "CancelToken.h"
+#include "OcrListener.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include <algorithm>
 
 OcrLite::OcrLite() {}
 
 OcrLite::~OcrLite() {}
 
-void OcrLite::init(JNIEnv *jniEnv, jobject assetManager, int numThread, std::string detName,
-                   std::string clsName, std::string recName, std::string keysName) {
-    AAssetManager *mgr = AAssetManager_fromJava(jniEnv, assetManager);
-    if (mgr == NULL) {
-        LOGE(" %s", "AAssetManager==NULL");
-    }
-
+void OcrLite::init(AAssetManager *mgr, int numThread, int boxWorkers,
+                   std::string detName, std::string clsName, std::string recName, std::string keysName) {
     Logger("--- Init DbNet ---\n");
     dbNet.setNumThread(numThread);
     dbNet.initModel(mgr, detName);
 
+    //boxes run on boxWorkers threads at once, each ort run gets its share of numThread
+    int boxThread = numThread;
+    if (boxWorkers > 1) {
+        boxPool.reset(new WorkStealingPool(boxWorkers));
+        boxThread = (std::max)(numThread / boxWorkers, 1);
+    }
+    Logger("boxWorkers(%d), boxThread(%d)", boxWorkers, boxThread);
+
     Logger("--- Init AngleNet ---\n");
-    angleNet.setNumThread(numThread);
+    angleNet.setNumThread(boxThread);
     angleNet.initModel(mgr, clsName);
 
     Logger("--- Init CrnnNet ---\n");
-    crnnNet.setNumThread(numThread);
+    crnnNet.setNumThread(boxThread);
     crnnNet.initModel(mgr, recName, keysName);
 
     LOGI("初始化完成!");
 }
 
+void OcrLite::setMaxRecWidth(int width) {
+    crnnNet.setMaxWidth(width);
+}
+
+void OcrLite::setRecCacheSize(int size) {
+    crnnNet.setCacheSize(size);
+}
+
+void OcrLite::setRecWidthQuantum(int quantum) {
+    crnnNet.setWidthQuantum(quantum);
+}
+
+void OcrLite::getRecShapeStats(int &rawShapes, int &runShapes) {
+    crnnNet.getShapeStats(rawShapes, runShapes);
+}
+
+void OcrLite::resetRecShapeStats() {
+    crnnNet.resetShapeStats();
+}
+
+std::vector<WorkerStats> OcrLite::getBoxWorkerStats() {
+    if (!boxPool) return {};
+    return boxPool->getStats();
+}
+
+void OcrLite::resetBoxWorkerStats() {
+    if (boxPool) boxPool->resetStats();
+}
+
+void OcrLite::getWorkspaceStats(long &allocations, long &reuses, long &heldBytes) {
+    workspacePool.getStats(allocations, reuses, heldBytes);
+}
+
+void OcrLite::setMemoryProbe(bool enabled) {
+    memoryProbe = enabled;
+}
+
+bool OcrLite::startProfiling(const std::string &prefix, int runs) {
+    bool started = dbNet.startProfiling(prefix + "dbNet", runs);
+    started = angleNet.startProfiling(prefix + "angleNet", runs) && started;
+    return crnnNet.startProfiling(prefix + "crnnNet", runs) && started;
+}
+
+std::string OcrLite::getProfileSummary(int topK) {
+    return formatOpProfiles("dbNet", dbNet.getOpProfiles(), topK) +
+           formatOpProfiles("angleNet", angleNet.getOpProfiles(), topK) +
+           formatOpProfiles("crnnNet", crnnNet.getOpProfiles(), topK);
+}
+
 /*void OcrLite::initLogger(bool isDebug) {
     isLOG = isDebug;
 }
@@ -44,20 +99,310 @@ void OcrLite::Logger(const char *format, ...) {
     free(buffer);
 }*/
 
-std::vector<cv::Mat> getPartImages(cv::Mat &src, std::vector<TextBox> &textBoxes) {
+std::vector<cv::Mat> getPartImages(cv::Mat &src, std::vector<TextBox> &textBoxes, CancelToken *token,
+                                   WorkStealingPool *pool, cv::MatAllocator *allocator) {
     std::vector<cv::Mat> partImages;
+    if (pool == nullptr) {
+        for (int i = 0; i < textBoxes.size(); ++i) {
+            if (token != nullptr && token->isStopped()) break;
+            TraceScope scope("crop", i);
+            cv::Mat partImg = getRotateCropImage(src, textBoxes[i].boxPoint, allocator);
+            partImages.emplace_back(partImg);
+        }
+        return partImages;
+    }
+    partImages.resize(textBoxes.size());
+    std::vector<std::function<void()>> tasks;
     for (int i = 0; i < textBoxes.size(); ++i) {
-        cv::Mat partImg = getRotateCropImage(src, textBoxes[i].boxPoint);
-        partImages.emplace_back(partImg);
+        tasks.emplace_back([&, i] {
+            if (token != nullptr && token->isStopped()) return;
+            TraceScope scope("crop", i);
+            partImages[i] = getRotateCropImage(src, textBoxes[i].boxPoint, allocator);
+        });
+    }
+    pool->run(tasks);
+    //stopped: keep the cropped prefix like the serial loop
+    for (int i = 0; i < partImages.size(); ++i) {
+        if (partImages[i].empty()) {
+            partImages.resize(i);
+            break;
+        }
     }
     return partImages;
 }
 
+//Moves the recognized lines to the front in detection order, like a call stopped part way through
+std::vector<TextLine> keepRecognizedLines(OcrFrame &frame, std::vector<Angle> &angles,
+                                          std::vector<TextLine> &textLines,
+                                          const std::vector<char> &recognized) {
+    std::vector<TextBox> &textBoxes = frame.textBoxes;
+    std::vector<cv::Mat> &partImages = frame.partImages;
+    std::vector<TextBox> keptBoxes;
+    std::vector<cv::Mat> keptImages;
+    std::vector<Angle> keptAngles;
+    std::vector<TextLine> keptLines;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < partImages.size(); ++i) {
+            if ((recognized[i] != 0) != (pass == 0)) continue;
+            keptBoxes.emplace_back(textBoxes[i]);
+            keptImages.emplace_back(partImages[i]);
+            keptAngles.emplace_back(angles[i]);
+            if (pass == 0) keptLines.emplace_back(textLines[i]);
+        }
+    }
+    for (int i = partImages.size(); i < textBoxes.size(); ++i) {
+        keptBoxes.emplace_back(textBoxes[i]);
+    }
+    textBoxes = keptBoxes;
+    partImages = keptImages;
+    angles = keptAngles;
+    return keptLines;
+}
+
+TextBox getOriginTextBox(TextBox &textBox, const cv::Point &offset) {
+    TextBox originBox = textBox;
+    for (int i = 0; i < originBox.boxPoint.size(); ++i) {
+        originBox.boxPoint[i] -= offset;
+    }
+    return originBox;
+}
+
+TextBlock getTextBlock(TextBox &textBox, Angle &angle, TextLine &textLine, const cv::Point &offset) {
+    //padding conversion
+    TextBox originBox = getOriginTextBox(textBox, offset);
+    return TextBlock{originBox.boxPoint, textBox.score, angle.index, angle.score,
+                     angle.time, textLine.text, textLine.charScores, textLine.time,
+                     angle.time + textLine.time};
+}
+
 OcrResult OcrLite::detect(cv::Mat &src, cv::Rect &originRect, ScaleParam &scale,
                           float boxScoreThresh, float boxThresh,
-                          float unClipRatio, bool doAngle, bool mostAngle) {
+                          float unClipRatio, bool doAngle, bool mostAngle,
+                          const std::string &allowedChars,
+                          const std::string &textPattern, bool luhnCheck) {
+    OcrFrame frame{0, src, originRect, scale, boxScoreThresh, boxThresh, unClipRatio,
+                   doAngle, mostAngle, allowedChars, textPattern, luhnCheck, nullptr, true};
+    return detect(frame);
+}
+
+void OcrLite::selectBudgetBoxes(OcrFrame &frame, std::vector<TextBox> &skippedBoxes, std::vector<int> &boxIndexes) {
+    std::vector<TextBox> &textBoxes = frame.textBoxes;
+    std::vector<cv::Mat> &partImages = frame.partImages;
+    double costPerCol;
+    {
+        std::lock_guard<std::mutex> lock(lineCostMutex);
+        costPerCol = lineCostPerCol;
+    }
+    double remaining = frame.budget - (getCurrentTime() - frame.startTime);
+    if (costPerCol <= 0.0 && remaining > 0.0) {
+        Logger("budget: no line cost measured yet, recognize all");
+        return;
+    }
+
+    //most likely text first: box score weighted by area
+    std::vector<int> order(partImages.size());
+    for (int i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return textBoxes[a].score * partImages[a].total() > textBoxes[b].score * partImages[b].total();
+    });
+    std::vector<bool> keep(partImages.size(), false);
+    for (int i : order) {
+        double cost = costPerCol * crnnNet.getInputWidth(partImages[i]);
+        if (cost <= remaining) {
+            keep[i] = true;
+            remaining -= cost;
+        }
+    }
+
+    //recognize kept boxes in detection order
+    std::vector<TextBox> keptBoxes;
+    std::vector<cv::Mat> keptImages;
+    for (int i = 0; i < partImages.size(); ++i) {
+        if (keep[i]) {
+            keptBoxes.emplace_back(textBoxes[i]);
+            keptImages.emplace_back(partImages[i]);
+            boxIndexes.emplace_back(i);
+        } else {
+            skippedBoxes.emplace_back(textBoxes[i]);
+        }
+    }
+    Logger("budget(%fms): recognize %ld, skip %ld, costPerCol(%fms)", frame.budget, keptBoxes.size(),
+           skippedBoxes.size(), costPerCol);
+    //boxes never cropped because the call was stopped are not skipped by the budget
+    for (int i = partImages.size(); i < textBoxes.size(); ++i) {
+        keptBoxes.emplace_back(textBoxes[i]);
+        boxIndexes.emplace_back(i);
+    }
+    textBoxes = keptBoxes;
+    partImages = keptImages;
+}
+
+std::vector<TextLine> OcrLite::getTextLinesProgressive(OcrFrame &frame, std::vector<Angle> &angles,
+                                                       const std::vector<int> &boxIndexes,
+                                                       const std::vector<int> &charsetIndexes,
+                                                       const TextPattern &pattern) {
+    std::vector<TextBox> &textBoxes = frame.textBoxes;
+    std::vector<cv::Mat> &partImages = frame.partImages;
+    CancelToken *token = frame.cancelToken.get();
+    Workspace &workspace = *frame.workspace;
+    cv::Point offset = frame.originRect.tl();
+    //without a budget nothing is cropped yet, each box is cropped right before it is recognized
+    if (frame.budget <= 0) partImages.resize(textBoxes.size());
+    int size = partImages.size();
+
+    std::vector<int> order(size);
+    for (int i = 0; i < order.size(); ++i) order[i] = i;
+    if (frame.largestFirst) {
+        std::vector<double> areas(size);
+        for (int i = 0; i < size; ++i) areas[i] = cv::contourArea(textBoxes[i].boxPoint);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return areas[a] > areas[b];
+        });
+    } else {
+        //reading order: top to bottom, then left to right for boxes on the same row
+        std::vector<cv::Rect> rects(size);
+        for (int i = 0; i < rects.size(); ++i) rects[i] = cv::boundingRect(textBoxes[i].boxPoint);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return rects[a].y < rects[b].y;
+        });
+        for (int i = 1; i < order.size(); ++i) {
+            for (int j = i; j > 0; --j) {
+                cv::Rect &prev = rects[order[j - 1]];
+                cv::Rect &cur = rects[order[j]];
+                bool sameRow = std::abs(cur.y - prev.y) < (std::min)(cur.height, prev.height) / 2;
+                if (!sameRow || prev.x <= cur.x) break;
+                std::swap(order[j - 1], order[j]);
+            }
+        }
+    }
+
+    angles.assign(size, Angle{-1, 0.f});
+    std::vector<TextLine> textLines(size);
+    std::vector<char> recognized(size, 0);
+    int angleVotes[2] = {0, 0};
+    for (int i : order) {
+        if (token != nullptr && token->isStopped()) break;
+        if (partImages[i].empty()) {
+            double startCropTime = getCurrentTime();
+            TraceScope scope("crop", i);
+            partImages[i] = getRotateCropImage(frame.src, textBoxes[i].boxPoint, workspace.getAllocator());
+            frame.stageTimes.crop += getCurrentTime() - startCropTime;
+        }
+        std::vector<cv::Mat> partImg{partImages[i]};
+        if (frame.doAngle) {
+            TraceScope scope("classify", i);
+            std::vector<Angle> boxAngles = angleNet.getAngles(partImg, true, false, token, workspace);
+            if (boxAngles.empty()) break;
+            angles[i] = boxAngles[0];
+            //majority of the boxes classified so far, the later ones are not waited for
+            if (frame.mostAngle) {
+                angleVotes[angles[i].index == 1 ? 1 : 0]++;
+                angles[i].index = angleVotes[1] * 2 >= angleVotes[0] + angleVotes[1] ? 1 : 0;
+            }
+            if (angles[i].index == 1) partImages[i] = partImg[0] = matRotateClockWise180(partImages[i]);
+        }
+        TraceScope scope("recognize", i);
+        std::vector<TextLine> lines = crnnNet.getTextLines(partImg, charsetIndexes, pattern, token, workspace);
+        if (lines.empty()) break;
+        textLines[i] = lines[0];
+        recognized[i] = 1;
+        TextBlock textBlock = getTextBlock(textBoxes[i], angles[i], textLines[i], offset);
+        frame.listener->onTextBlock(boxIndexes.empty() ? i : boxIndexes[i], textBlock);
+    }
+    return keepRecognizedLines(frame, angles, textLines, recognized);
+}
+
+std::vector<TextLine> OcrLite::getTextLinesPooled(OcrFrame &frame, std::vector<Angle> &angles,
+                                                  const std::vector<int> &charsetIndexes,
+                                                  const TextPattern &pattern) {
+    std::vector<cv::Mat> &partImages = frame.partImages;
+    CancelToken *token = frame.cancelToken.get();
+    int size = partImages.size();
+    angles.assign(size, Angle{-1, 0.f});
+    std::vector<TextLine> textLines(size);
+    //written by different workers, so no vector<bool>
+    std::vector<char> classified(size, 0);
+    std::vector<char> recognized(size, 0);
+
+    auto classify = [&](int i) {
+        if (!frame.doAngle) {
+            classified[i] = 1;
+            return;
+        }
+        TraceScope scope("classify", i);
+        std::vector<cv::Mat> partImg{partImages[i]};
+        WorkspaceLease lease(workspacePool, frame.workspace->getMeter());
+        std::vector<Angle> boxAngles = angleNet.getAngles(partImg, true, false, token, lease.get());
+        if (boxAngles.empty()) return;
+        angles[i] = boxAngles[0];
+        classified[i] = 1;
+    };
+    auto recognize = [&](int i) {
+        if (!classified[i]) return;
+        TraceScope scope("recognize", i);
+        if (angles[i].index == 1) partImages[i] = matRotateClockWise180(partImages[i]);
+        std::vector<cv::Mat> partImg{partImages[i]};
+        WorkspaceLease lease(workspacePool, frame.workspace->getMeter());
+        std::vector<TextLine> lines = crnnNet.getTextLines(partImg, charsetIndexes, pattern, token,
+                                                           lease.get());
+        if (lines.empty()) return;
+        textLines[i] = lines[0];
+        recognized[i] = 1;
+    };
+
+    std::vector<std::function<void()>> tasks;
+    if (frame.doAngle && frame.mostAngle) {
+        //the majority angle needs every box classified before any is rotated
+        for (int i = 0; i < size; ++i) {
+            tasks.emplace_back([&, i] { classify(i); });
+        }
+        boxPool->run(tasks);
+        std::vector<Angle> classifiedAngles;
+        for (int i = 0; i < size; ++i) {
+            if (classified[i]) classifiedAngles.emplace_back(angles[i]);
+        }
+        angleNet.setMostAngle(classifiedAngles);
+        for (int i = 0, c = 0; i < size; ++i) {
+            if (classified[i]) angles[i] = classifiedAngles[c++];
+        }
+        tasks.clear();
+        for (int i = 0; i < size; ++i) {
+            tasks.emplace_back([&, i] { recognize(i); });
+        }
+    } else {
+        for (int i = 0; i < size; ++i) {
+            tasks.emplace_back([&, i] {
+                classify(i);
+                recognize(i);
+            });
+        }
+    }
+    boxPool->run(tasks);
+    return keepRecognizedLines(frame, angles, textLines, recognized);
+}
+
+void OcrLite::updateLineCost(std::vector<cv::Mat> &partImages, std::vector<Angle> &angles,
+                             std::vector<TextLine> &textLines) {
+    std::lock_guard<std::mutex> lock(lineCostMutex);
+    for (int i = 0; i < textLines.size(); ++i) {
+        if (textLines[i].cached) continue;
+        int width = crnnNet.getInputWidth(partImages[i]);
+        if (width <= 0) continue;
+        double sample = (angles[i].time + textLines[i].time) / width;
+        lineCostPerCol = lineCostPerCol > 0.0 ? lineCostPerCol * 0.9 + sample * 0.1 : sample;
+    }
+}
+
+OcrResult OcrLite::detect(OcrFrame &frame) {
+    detectTextBoxes(frame);
+    return recognizeTextBoxes(frame);
+}
+
+void OcrLite::detectTextBoxes(OcrFrame &frame) {
+    TraceScope scope("detectTextBoxes", frame.id);
+    cv::Mat &src = frame.src;
+    ScaleParam &scale = frame.scale;
 
-    cv::Mat textBoxPaddingImg = src.clone();
     int thickness = getThickness(src);
 
     Logger("=====Start detect=====");
@@ -66,12 +411,35 @@ OcrResult OcrLite::detect(cv::Mat &src, cv::Rect &originRect, ScaleParam &scale,
            scale.ratioWidth, scale.ratioHeight);
 
     Logger("---------- step: dbNet getTextBoxes ----------");
-    double startTime = getCurrentTime();
-    std::vector<TextBox> textBoxes = dbNet.getTextBoxes(src, scale, boxScoreThresh, boxThresh, unClipRatio);
+    frame.startTime = getCurrentTime();
+    std::vector<TextBox> &textBoxes = frame.textBoxes;
+    CancelToken *token = frame.cancelToken.get();
+    if (!frame.workspace) {
+        frame.workspace = FrameWorkspace(workspacePool.acquire(), WorkspaceReleaser{&workspacePool});
+    }
+    Workspace &workspace = *frame.workspace;
+    MemoryMeter *meter = workspace.getMeter();
+    meter->setHeapProbe(memoryProbe);
+    meter->markHeapStart();
+    meter->startStage();
+    frame.memoryStats = MemoryStats{};
+    frame.stageTimes = StageTimes{};
+    frame.stageCounters = StageCounters{};
+    textBoxes = dbNet.getTextBoxes(src, scale, frame.boxScoreThresh, frame.boxThresh, frame.unClipRatio, token,
+                                   workspace, frame.stageTimes, frame.stageCounters);
     Logger("TextBoxesSize(%ld)", textBoxes.size());
     double endDbNetTime = getCurrentTime();
-    double dbNetTime = endDbNetTime - startTime;
-    Logger("dbNetTime(%fms)", dbNetTime);
+    frame.dbNetTime = endDbNetTime - frame.startTime;
+    Logger("dbNetTime(%fms)", frame.dbNetTime);
+    frame.memoryStats.detectPeak = meter->getPeak();
+
+    if (frame.listener != nullptr) {
+        std::vector<TextBox> originBoxes;
+        for (int i = 0; i < textBoxes.size(); ++i) {
+            originBoxes.emplace_back(getOriginTextBox(textBoxes[i], frame.originRect.tl()));
+        }
+        frame.listener->onTextBoxes(originBoxes);
+    }
 
     for (int i = 0; i < textBoxes.size(); ++i) {
         Logger("TextBox[%d][score(%f),[x: %d, y: %d], [x: %d, y: %d], [x: %d, y: %d], [x: %d, y: %d]]",
@@ -83,30 +451,91 @@ OcrResult OcrLite::detect(cv::Mat &src, cv::Rect &originRect, ScaleParam &scale,
                textBoxes[i].boxPoint[3].x, textBoxes[i].boxPoint[3].y);
     }
 
-    Logger("---------- step: drawTextBoxes ----------");
-    drawTextBoxes(textBoxPaddingImg, textBoxes, thickness);
+    if (frame.drawBoxImg) {
+        Logger("---------- step: drawTextBoxes ----------");
+        if (frame.boxImg.empty()) {
+            frame.boxImg = src(frame.originRect).clone();
+        }
+        drawTextBoxes(frame.boxImg, textBoxes, thickness, frame.originRect.tl());
+    }
+
+    //progressive frames crop each box when its turn comes, unless the budget needs the size of every crop
+    if (frame.listener != nullptr && frame.budget <= 0) return;
 
     //---------- getPartImages ----------
-    std::vector<cv::Mat> partImages = getPartImages(src, textBoxes);
+    double startCropTime = getCurrentTime();
+    meter->startStage();
+    PerfSample cropSample = readPerfCounters();
+    frame.partImages = getPartImages(src, textBoxes, token, boxPool.get(), workspace.getAllocator());
+    addPerfSample(frame.stageCounters.crop, cropSample, readPerfCounters());
+    double endCropTime = getCurrentTime();
+    frame.stageTimes.crop = endCropTime - startCropTime;
+    frame.memoryStats.cropPeak = meter->getPeak();
+    addTraceSpan("getPartImages", frame.partImages.size(), startCropTime, endCropTime);
+}
 
-    Logger("---------- step: angleNet getAngles ----------");
-    std::vector<Angle> angles;
-    angles = angleNet.getAngles(partImages, doAngle, mostAngle);
+OcrResult OcrLite::recognizeTextBoxes(OcrFrame &frame) {
+    TraceScope scope("recognizeTextBoxes", frame.id);
+    std::vector<TextBox> &textBoxes = frame.textBoxes;
+    std::vector<cv::Mat> &partImages = frame.partImages;
+    cv::Rect &originRect = frame.originRect;
 
-    //Log Angles
-    for (int i = 0; i < angles.size(); ++i) {
-        Logger("angle[%d][index(%d), score(%f), time(%fms)]", i, angles[i].index, angles[i].score, angles[i].time);
+    std::vector<TextBox> skippedBoxes;
+    //position of each box left by the budget in the boxes given to onTextBoxes, empty when all are left
+    std::vector<int> boxIndexes;
+    if (frame.budget > 0) {
+        Logger("---------- step: selectBudgetBoxes ----------");
+        selectBudgetBoxes(frame, skippedBoxes, boxIndexes);
     }
 
-    //Rotate partImgs
-    for (int i = 0; i < partImages.size(); ++i) {
-        if (angles[i].index == 1) {
-            partImages.at(i) = matRotateClockWise180(partImages[i]);
+    CancelToken *token = frame.cancelToken.get();
+    MemoryMeter *meter = frame.workspace->getMeter();
+    meter->startStage();
+    PerfSample recognizeSample = readPerfCounters();
+    //compiled by an earlier call with the same options, kept alive here in case the cache drops them
+    std::shared_ptr<const std::vector<int>> charset = crnnNet.getCharsetIndexes(frame.allowedChars);
+    std::shared_ptr<const TextPattern> textPattern = crnnNet.getTextPattern(frame.textPattern, frame.luhnCheck);
+    const std::vector<int> &charsetIndexes = *charset;
+    const TextPattern &pattern = *textPattern;
+    std::vector<Angle> angles;
+    std::vector<TextLine> textLines;
+    if (frame.listener != nullptr) {
+        //progressive results are reported from the calling thread, so they stay serial
+        Logger("---------- step: progressive crop + getAngle + getTextLine ----------");
+        PerfScope crnnPerf(frame.stageCounters.crnn);
+        textLines = getTextLinesProgressive(frame, angles, boxIndexes, charsetIndexes, pattern);
+    } else if (boxPool) {
+        Logger("---------- step: boxPool getAngle + getTextLine ----------");
+        textLines = getTextLinesPooled(frame, angles, charsetIndexes, pattern);
+    } else {
+        Logger("---------- step: angleNet getAngles ----------");
+        double startAngleTime = getCurrentTime();
+        PerfSample angleSample = readPerfCounters();
+        angles = angleNet.getAngles(partImages, frame.doAngle, frame.mostAngle, token, *frame.workspace);
+        addPerfSample(frame.stageCounters.angle, angleSample, readPerfCounters());
+        addTraceSpan("getAngles", angles.size(), startAngleTime, getCurrentTime());
+
+        //Log Angles
+        for (int i = 0; i < angles.size(); ++i) {
+            Logger("angle[%d][index(%d), score(%f), time(%fms)]", i, angles[i].index, angles[i].score,
+                   angles[i].time);
+        }
+
+        //Rotate partImgs
+        for (int i = 0; i < angles.size(); ++i) {
+            if (angles[i].index == 1) {
+                partImages.at(i) = matRotateClockWise180(partImages[i]);
+            }
         }
-    }
 
-    Logger("---------- step: crnnNet getTextLine ----------");
-    std::vector<TextLine> textLines = crnnNet.getTextLines(partImages);
+        Logger("---------- step: crnnNet getTextLine ----------");
+        //boxes without an angle were never classified because the call was stopped
+        partImages.resize(angles.size());
+        PerfScope crnnPerf(frame.stageCounters.crnn);
+        TraceScope crnnScope("getTextLines", partImages.size());
+        textLines = crnnNet.getTextLines(partImages, charsetIndexes, pattern, token, *frame.workspace);
+    }
+    addPerfSample(frame.stageCounters.recognize, recognizeSample, readPerfCounters());
     //Log TextLines
     for (int i = 0; i < textLines.size(); ++i) {
         Logger("textLine[%d](%s)", i, textLines[i].text.c_str());
@@ -122,38 +551,52 @@ OcrResult OcrLite::detect(cv::Mat &src, cv::Rect &originRect, ScaleParam &scale,
         Logger("crnnTime[%d](%fms)", i, textLines[i].time);
     }
 
+    updateLineCost(partImages, angles, textLines);
+
+    int cacheHits = 0;
+    int cacheMisses = 0;
+    if (crnnNet.getCacheSize() > 0) {
+        for (int i = 0; i < textLines.size(); ++i) {
+            if (textLines[i].cached) cacheHits++;
+            else cacheMisses++;
+        }
+        Logger("crnnCache(hits:%d, misses:%d)", cacheHits, cacheMisses);
+    }
+
     std::vector<TextBlock> textBlocks;
     for (int i = 0; i < textLines.size(); ++i) {
-        std::vector<cv::Point> boxPoint = std::vector<cv::Point>(4);
-        int padding = originRect.x;//padding conversion
-        boxPoint[0] = cv::Point(textBoxes[i].boxPoint[0].x - padding, textBoxes[i].boxPoint[0].y - padding);
-        boxPoint[1] = cv::Point(textBoxes[i].boxPoint[1].x - padding, textBoxes[i].boxPoint[1].y - padding);
-        boxPoint[2] = cv::Point(textBoxes[i].boxPoint[2].x - padding, textBoxes[i].boxPoint[2].y - padding);
-        boxPoint[3] = cv::Point(textBoxes[i].boxPoint[3].x - padding, textBoxes[i].boxPoint[3].y - padding);
-        TextBlock textBlock{boxPoint, textBoxes[i].score, angles[i].index, angles[i].score,
-                            angles[i].time, textLines[i].text, textLines[i].charScores, textLines[i].time,
-                            angles[i].time + textLines[i].time};
-        textBlocks.emplace_back(textBlock);
+        textBlocks.emplace_back(getTextBlock(textBoxes[i], angles[i], textLines[i], originRect.tl()));
+        frame.stageTimes.angle += angles[i].time;
+        frame.stageTimes.crnn += textLines[i].time;
     }
 
+    MemoryStats &memoryStats = frame.memoryStats;
+    memoryStats.recognizePeak = meter->getPeak();
+    memoryStats.largestMat = meter->getLargestMat();
+    memoryStats.dbNetHeapGrowth = meter->getHeapGrowth(MemoryMeter::DB_NET);
+    memoryStats.angleNetHeapGrowth = meter->getHeapGrowth(MemoryMeter::ANGLE_NET);
+    memoryStats.crnnNetHeapGrowth = meter->getHeapGrowth(MemoryMeter::CRNN_NET);
+    memoryStats.frameHeapGrowth = meter->getHeapSinceStart();
+    frame.workspace.reset();
+
     double endTime = getCurrentTime();
-    double fullTime = endTime - startTime;
+    double fullTime = endTime - frame.startTime;
     Logger("=====End detect=====");
     Logger("FullDetectTime(%fms)", fullTime);
 
-    //cropped to original size
-    cv::Mat textBoxImg;
-    if (originRect.x > 0 && originRect.y > 0) {
-        textBoxPaddingImg(originRect).copyTo(textBoxImg);
-    } else {
-        textBoxImg = textBoxPaddingImg;
-    }
-
     std::string strRes;
     for (int i = 0; i < textBlocks.size(); ++i) {
         strRes.append(textBlocks[i].text);
         strRes.append("\n");
     }
 
-    return OcrResult{dbNetTime, textBlocks, textBoxImg, fullTime, strRes};
+    bool partial = textBlocks.size() < textBoxes.size() || (token != nullptr && token->isStopped());
+    if (partial) Logger("partial result(%ld/%ld)", textBlocks.size(), textBoxes.size());
+
+    for (int i = 0; i < skippedBoxes.size(); ++i) {
+        skippedBoxes[i] = getOriginTextBox(skippedBoxes[i], originRect.tl());
+    }
+
+    return OcrResult{frame.dbNetTime, textBlocks, frame.boxImg, fullTime, strRes, cacheHits, cacheMisses, partial,
+                     skippedBoxes, frame.stageTimes, frame.memoryStats, frame.stageCounters};
 }
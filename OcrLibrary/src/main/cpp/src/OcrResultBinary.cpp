@@ -0,0 +1,216 @@
+#include "OcrResultBinary.h"
+#include <cstring>
+
+static const uint8_t binaryMagic[4] = {'O', 'C', 'R', 'B'};
+static const size_t headerSize = 44;
+static const size_t boxPointSize = 8 * 4;
+//box points, boxScore, angleIndex, angleScore, 3 times, text bytes, char count
+static const size_t blockFixedSize = boxPointSize + 4 + 4 + 4 + 3 * 8 + 4 + 4;
+static const size_t skippedBoxSize = boxPointSize + 4;
+
+//explicit byte order, compilers turn these into plain stores/loads on little-endian targets
+static inline void putU16(uint8_t *&p, uint16_t value) {
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p += 2;
+}
+
+static inline void putU32(uint8_t *&p, uint32_t value) {
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+    p += 4;
+}
+
+static inline void putU64(uint8_t *&p, uint64_t value) {
+    putU32(p, (uint32_t) value);
+    putU32(p, (uint32_t) (value >> 32));
+}
+
+static inline void putF32(uint8_t *&p, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    putU32(p, bits);
+}
+
+static inline void putF64(uint8_t *&p, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, 8);
+    putU64(p, bits);
+}
+
+static inline uint16_t getU16(const uint8_t *p) {
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static inline uint32_t getU32(const uint8_t *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint64_t getU64(const uint8_t *p) {
+    return (uint64_t) getU32(p) | ((uint64_t) getU32(p + 4) << 32);
+}
+
+static inline float getF32(const uint8_t *p) {
+    uint32_t bits = getU32(p);
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+static inline double getF64(const uint8_t *p) {
+    uint64_t bits = getU64(p);
+    double value;
+    memcpy(&value, &bits, 8);
+    return value;
+}
+
+//4 points, missing ones as 0
+static void putBoxPoint(uint8_t *&p, const std::vector<cv::Point> &boxPoint) {
+    for (int i = 0; i < 4; ++i) {
+        cv::Point point = i < boxPoint.size() ? boxPoint[i] : cv::Point();
+        putU32(p, (uint32_t) point.x);
+        putU32(p, (uint32_t) point.y);
+    }
+}
+
+static void getBoxPoint(const uint8_t *p, int32_t *boxPoint) {
+    for (int i = 0; i < 8; ++i) {
+        boxPoint[i] = (int32_t) getU32(p + i * 4);
+    }
+}
+
+size_t getBinaryResultSize(const OcrResult &ocrResult) {
+    size_t size = headerSize + ocrResult.skippedBoxes.size() * skippedBoxSize;
+    for (auto &textBlock : ocrResult.textBlocks) {
+        size += blockFixedSize + textBlock.text.size() + textBlock.charScores.size() * 4;
+    }
+    return size;
+}
+
+size_t writeBinaryResult(const OcrResult &ocrResult, uint8_t *buffer, size_t capacity) {
+    size_t size = getBinaryResultSize(ocrResult);
+    if (buffer == nullptr || size > capacity || size > UINT32_MAX) return 0;
+    uint8_t *p = buffer;
+    memcpy(p, binaryMagic, 4);
+    p += 4;
+    putU16(p, OCR_BINARY_VERSION);
+    putU16(p, ocrResult.partial ? 1 : 0);
+    putU32(p, (uint32_t) size);
+    putU32(p, (uint32_t) ocrResult.textBlocks.size());
+    putU32(p, (uint32_t) ocrResult.skippedBoxes.size());
+    putU32(p, (uint32_t) ocrResult.cacheHits);
+    putU32(p, (uint32_t) ocrResult.cacheMisses);
+    putF64(p, ocrResult.dbNetTime);
+    putF64(p, ocrResult.detectTime);
+    for (auto &textBlock : ocrResult.textBlocks) {
+        putBoxPoint(p, textBlock.boxPoint);
+        putF32(p, textBlock.boxScore);
+        putU32(p, (uint32_t) textBlock.angleIndex);
+        putF32(p, textBlock.angleScore);
+        putF64(p, textBlock.angleTime);
+        putF64(p, textBlock.crnnTime);
+        putF64(p, textBlock.blockTime);
+        putU32(p, (uint32_t) textBlock.text.size());
+        putU32(p, (uint32_t) textBlock.charScores.size());
+        memcpy(p, textBlock.text.data(), textBlock.text.size());
+        p += textBlock.text.size();
+        for (float score : textBlock.charScores) {
+            putF32(p, score);
+        }
+    }
+    for (auto &textBox : ocrResult.skippedBoxes) {
+        putBoxPoint(p, textBox.boxPoint);
+        putF32(p, textBox.score);
+    }
+    return p - buffer;
+}
+
+float BinaryTextBlock::getCharScore(uint32_t index) const {
+    return getF32(charScores + index * 4);
+}
+
+BinaryResultReader::BinaryResultReader(const uint8_t *buffer, size_t size)
+        : buffer(buffer), size(size), offset(headerSize), blocksRead(0), skippedRead(0) {
+    valid = buffer != nullptr && size >= headerSize && memcmp(buffer, binaryMagic, 4) == 0 &&
+            getU16(buffer + 4) == OCR_BINARY_VERSION && getU32(buffer + 8) >= headerSize &&
+            getU32(buffer + 8) <= size;
+    //from here on only the declared size is read
+    if (valid) this->size = getU32(buffer + 8);
+}
+
+bool BinaryResultReader::isValid() const {
+    return valid;
+}
+
+size_t BinaryResultReader::getSize() const {
+    return valid ? size : 0;
+}
+
+bool BinaryResultReader::isPartial() const {
+    return valid && (getU16(buffer + 6) & 1) != 0;
+}
+
+uint32_t BinaryResultReader::getBlockCount() const {
+    return valid ? getU32(buffer + 12) : 0;
+}
+
+uint32_t BinaryResultReader::getSkippedCount() const {
+    return valid ? getU32(buffer + 16) : 0;
+}
+
+int32_t BinaryResultReader::getCacheHits() const {
+    return valid ? (int32_t) getU32(buffer + 20) : 0;
+}
+
+int32_t BinaryResultReader::getCacheMisses() const {
+    return valid ? (int32_t) getU32(buffer + 24) : 0;
+}
+
+double BinaryResultReader::getDbNetTime() const {
+    return valid ? getF64(buffer + 28) : 0.0;
+}
+
+double BinaryResultReader::getDetectTime() const {
+    return valid ? getF64(buffer + 36) : 0.0;
+}
+
+bool BinaryResultReader::nextBlock(BinaryTextBlock &block) {
+    if (!valid || blocksRead >= getBlockCount() || size - offset < blockFixedSize) return false;
+    const uint8_t *p = buffer + offset;
+    getBoxPoint(p, block.boxPoint);
+    p += boxPointSize;
+    block.boxScore = getF32(p);
+    block.angleIndex = (int32_t) getU32(p + 4);
+    block.angleScore = getF32(p + 8);
+    block.angleTime = getF64(p + 12);
+    block.crnnTime = getF64(p + 20);
+    block.blockTime = getF64(p + 28);
+    block.textLength = getU32(p + 36);
+    block.charCount = getU32(p + 40);
+    p += blockFixedSize - boxPointSize;
+    size_t variableSize = (size_t) block.textLength + (size_t) block.charCount * 4;
+    if (size - offset - blockFixedSize < variableSize) {
+        valid = false;
+        return false;
+    }
+    block.text = (const char *) p;
+    block.charScores = p + block.textLength;
+    offset += blockFixedSize + variableSize;
+    blocksRead++;
+    return true;
+}
+
+bool BinaryResultReader::nextSkippedBox(BinaryTextBox &textBox) {
+    BinaryTextBlock block;
+    while (blocksRead < getBlockCount()) {
+        if (!nextBlock(block)) return false;
+    }
+    if (!valid || skippedRead >= getSkippedCount() || size - offset < skippedBoxSize) return false;
+    getBoxPoint(buffer + offset, textBox.boxPoint);
+    textBox.score = getF32(buffer + offset + boxPointSize);
+    offset += skippedBoxSize;
+    skippedRead++;
+    return true;
+}
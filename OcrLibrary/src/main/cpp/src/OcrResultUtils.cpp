@@ -1,25 +1,90 @@
 #include <OcrUtils.h>
 #include "OcrResultUtils.h"
 
-OcrResultUtils::OcrResultUtils(JNIEnv *env, OcrResult &ocrResult, jobject boxImg) {
-    jniEnv = env;
-
-    jclass jOcrResultClass = env->FindClass("com/benjaminwan/ocrlibrary/OcrResult");
+//class refs are global, ids stay valid while the classes are loaded
+struct JniIds {
+    jclass listClass;
+    jmethodID listConstructor;
+    jmethodID listAdd;
+    jclass stringClass;
+    jclass pointClass;
+    jmethodID pointConstructor;
+    jclass textBoxClass;
+    jmethodID textBoxConstructor;
+    jclass textBlockClass;
+    jmethodID textBlockConstructor;
+    jclass ocrResultClass;
+    jmethodID ocrResultConstructor;
+    jclass flatResultClass;
+    jmethodID flatResultConstructor;
+};
+
+static JniIds jniIds;
+
+static jclass findGlobalClass(JNIEnv *env, const char *name) {
+    jclass clazz = env->FindClass(name);
+    if (clazz == NULL) {
+        LOGE("%s class is null", name);
+        return NULL;
+    }
+    jclass globalClass = (jclass) env->NewGlobalRef(clazz);
+    env->DeleteLocalRef(clazz);
+    return globalClass;
+}
 
-    if (jOcrResultClass == NULL) {
-        LOGE("OcrResult class is null");
+bool OcrResultUtils::initJniIds(JNIEnv *env) {
+    JniIds &ids = jniIds;
+    ids.listClass = findGlobalClass(env, "java/util/ArrayList");
+    ids.stringClass = findGlobalClass(env, "java/lang/String");
+    ids.pointClass = findGlobalClass(env, "com/benjaminwan/ocrlibrary/Point");
+    ids.textBoxClass = findGlobalClass(env, "com/benjaminwan/ocrlibrary/TextBox");
+    ids.textBlockClass = findGlobalClass(env, "com/benjaminwan/ocrlibrary/TextBlock");
+    ids.ocrResultClass = findGlobalClass(env, "com/benjaminwan/ocrlibrary/OcrResult");
+    ids.flatResultClass = findGlobalClass(env, "com/benjaminwan/ocrlibrary/FlatOcrResult");
+    if (ids.listClass == NULL || ids.stringClass == NULL || ids.pointClass == NULL ||
+        ids.textBoxClass == NULL || ids.textBlockClass == NULL || ids.ocrResultClass == NULL ||
+        ids.flatResultClass == NULL) {
+        return false;
     }
+    ids.listConstructor = env->GetMethodID(ids.listClass, "<init>", "(I)V");
+    ids.listAdd = env->GetMethodID(ids.listClass, "add", "(Ljava/lang/Object;)Z");
+    ids.pointConstructor = env->GetMethodID(ids.pointClass, "<init>", "(II)V");
+    ids.textBoxConstructor = env->GetMethodID(ids.textBoxClass, "<init>", "(Ljava/util/ArrayList;F)V");
+    ids.textBlockConstructor = env->GetMethodID(ids.textBlockClass, "<init>",
+                                                "(Ljava/util/ArrayList;FIFDLjava/lang/String;[FDD)V");
+    ids.ocrResultConstructor = env->GetMethodID(ids.ocrResultClass, "<init>",
+                                                "(DLjava/util/ArrayList;Landroid/graphics/Bitmap;DLjava/lang/String;IIZLjava/util/ArrayList;[J)V");
+    ids.flatResultConstructor = env->GetMethodID(ids.flatResultClass, "<init>",
+                                                 "(DDLandroid/graphics/Bitmap;[I[F[I[F[D[Ljava/lang/String;[F[IIIZ[I[F)V");
+    return ids.listConstructor != NULL && ids.listAdd != NULL && ids.pointConstructor != NULL &&
+           ids.textBoxConstructor != NULL && ids.textBlockConstructor != NULL &&
+           ids.ocrResultConstructor != NULL && ids.flatResultConstructor != NULL;
+}
 
-    jmethodID jOcrResultConstructor = env->GetMethodID(jOcrResultClass, "<init>",
-                                                       "(DLjava/util/ArrayList;Landroid/graphics/Bitmap;DLjava/lang/String;)V");
+OcrResultUtils::OcrResultUtils(JNIEnv *env, OcrResult &ocrResult, jobject boxImg) {
+    jniEnv = env;
 
     jobject textBlocks = getTextBlocks(ocrResult.textBlocks);
     jdouble dbNetTime = (jdouble) ocrResult.dbNetTime;
     jdouble detectTime = (jdouble) ocrResult.detectTime;
     jstring jStrRest = jniEnv->NewStringUTF(ocrResult.strRes.c_str());
+    jobject skippedBoxes = getTextBoxes(ocrResult.skippedBoxes);
+    MemoryStats &memory = ocrResult.memoryStats;
+    jlong memoryValues[8] = {memory.detectPeak, memory.cropPeak, memory.recognizePeak, memory.largestMat,
+                             memory.dbNetHeapGrowth, memory.angleNetHeapGrowth, memory.crnnNetHeapGrowth,
+                             memory.frameHeapGrowth};
+    jlongArray memoryStats = env->NewLongArray(8);
+    env->SetLongArrayRegion(memoryStats, 0, 8, memoryValues);
+
+    jOcrResult = env->NewObject(jniIds.ocrResultClass, jniIds.ocrResultConstructor, dbNetTime,
+                                textBlocks, boxImg, detectTime, jStrRest,
+                                (jint) ocrResult.cacheHits, (jint) ocrResult.cacheMisses,
+                                (jboolean) ocrResult.partial, skippedBoxes, memoryStats);
+}
 
-    jOcrResult = env->NewObject(jOcrResultClass, jOcrResultConstructor, dbNetTime,
-                                textBlocks, boxImg, detectTime, jStrRest);
+OcrResultUtils::OcrResultUtils(JNIEnv *env) {
+    jniEnv = env;
+    jOcrResult = NULL;
 }
 
 OcrResultUtils::~OcrResultUtils() {
@@ -30,40 +95,20 @@ jobject OcrResultUtils::getJObject() {
     return jOcrResult;
 }
 
-jclass OcrResultUtils::newJListClass() {
-    jclass clazz = jniEnv->FindClass("java/util/ArrayList");
-    if (clazz == NULL) {
-        LOGE("ArrayList class is null");
-        return NULL;
-    }
-    return clazz;
-}
-
-jmethodID OcrResultUtils::getListConstructor(jclass clazz) {
-    jmethodID constructor = jniEnv->GetMethodID(clazz, "<init>", "()V");
-    return constructor;
+jobject OcrResultUtils::newJList(int capacity) {
+    return jniEnv->NewObject(jniIds.listClass, jniIds.listConstructor, (jint) capacity);
 }
 
 jobject OcrResultUtils::newJPoint(cv::Point &point) {
-    jclass clazz = jniEnv->FindClass("com/benjaminwan/ocrlibrary/Point");
-    if (clazz == NULL) {
-        LOGE("Point class is null");
-        return NULL;
-    }
-    jmethodID constructor = jniEnv->GetMethodID(clazz, "<init>", "(II)V");
-    jobject obj = jniEnv->NewObject(clazz, constructor, point.x, point.y);
-    return obj;
+    return jniEnv->NewObject(jniIds.pointClass, jniIds.pointConstructor, point.x, point.y);
 }
 
 jobject OcrResultUtils::newJBoxPoint(std::vector<cv::Point> &boxPoint) {
-    jclass jListClass = newJListClass();
-    jmethodID jListConstructor = getListConstructor(jListClass);
-    jobject jList = jniEnv->NewObject(jListClass, jListConstructor);
-    jmethodID jListAdd = jniEnv->GetMethodID(jListClass, "add", "(Ljava/lang/Object;)Z");
-
+    jobject jList = newJList(boxPoint.size());
     for (auto point : boxPoint) {
         jobject jPoint = newJPoint(point);
-        jniEnv->CallBooleanMethod(jList, jListAdd, jPoint);
+        jniEnv->CallBooleanMethod(jList, jniIds.listAdd, jPoint);
+        jniEnv->DeleteLocalRef(jPoint);
     }
     return jList;
 }
@@ -77,29 +122,39 @@ jobject OcrResultUtils::getTextBlock(TextBlock &textBlock) {
     jobject jCharScores = newJScoreArray(textBlock.charScores);
     jdouble jCrnnTime = (jdouble) textBlock.crnnTime;
     jdouble jBlockTime = (jdouble) textBlock.blockTime;
-    jclass clazz = jniEnv->FindClass("com/benjaminwan/ocrlibrary/TextBlock");
-    if (clazz == NULL) {
-        LOGE("TextBlock class is null");
-        return NULL;
-    }
-    jmethodID constructor = jniEnv->GetMethodID(clazz, "<init>",
-                                                "(Ljava/util/ArrayList;FIFDLjava/lang/String;[FDD)V");
-    jobject obj = jniEnv->NewObject(clazz, constructor, jBoxPint, jBoxScore, textBlock.angleIndex,
-                                    jAngleScore, jAngleTime, jText, jCharScores, jCrnnTime,
-                                    jBlockTime);
+    jobject obj = jniEnv->NewObject(jniIds.textBlockClass, jniIds.textBlockConstructor, jBoxPint, jBoxScore,
+                                    textBlock.angleIndex, jAngleScore, jAngleTime, jText, jCharScores,
+                                    jCrnnTime, jBlockTime);
+    jniEnv->DeleteLocalRef(jBoxPint);
+    jniEnv->DeleteLocalRef(jText);
+    jniEnv->DeleteLocalRef(jCharScores);
     return obj;
 }
 
-jobject OcrResultUtils::getTextBlocks(std::vector<TextBlock> &textBlocks) {
-    jclass jListClass = newJListClass();
-    jmethodID jListConstructor = getListConstructor(jListClass);
-    jobject jList = jniEnv->NewObject(jListClass, jListConstructor);
-    jmethodID jListAdd = jniEnv->GetMethodID(jListClass, "add", "(Ljava/lang/Object;)Z");
+jobject OcrResultUtils::getTextBox(TextBox &textBox) {
+    jobject jBoxPint = newJBoxPoint(textBox.boxPoint);
+    jobject obj = jniEnv->NewObject(jniIds.textBoxClass, jniIds.textBoxConstructor, jBoxPint,
+                                    (jfloat) textBox.score);
+    jniEnv->DeleteLocalRef(jBoxPint);
+    return obj;
+}
 
+jobject OcrResultUtils::getTextBoxes(std::vector<TextBox> &textBoxes) {
+    jobject jList = newJList(textBoxes.size());
+    for (int i = 0; i < textBoxes.size(); ++i) {
+        jobject jTextBox = getTextBox(textBoxes[i]);
+        jniEnv->CallBooleanMethod(jList, jniIds.listAdd, jTextBox);
+        jniEnv->DeleteLocalRef(jTextBox);
+    }
+    return jList;
+}
+
+jobject OcrResultUtils::getTextBlocks(std::vector<TextBlock> &textBlocks) {
+    jobject jList = newJList(textBlocks.size());
     for (int i = 0; i < textBlocks.size(); ++i) {
-        auto textBlock = textBlocks[i];
-        jobject jTextBlock = getTextBlock(textBlock);
-        jniEnv->CallBooleanMethod(jList, jListAdd, jTextBlock);
+        jobject jTextBlock = getTextBlock(textBlocks[i]);
+        jniEnv->CallBooleanMethod(jList, jniIds.listAdd, jTextBlock);
+        jniEnv->DeleteLocalRef(jTextBlock);
     }
     return jList;
 }
@@ -108,4 +163,80 @@ jfloatArray OcrResultUtils::newJScoreArray(std::vector<float> &scores) {
     jfloatArray jScores = jniEnv->NewFloatArray(scores.size());
     jniEnv->SetFloatArrayRegion(jScores, 0, scores.size(), (jfloat *) scores.data());
     return jScores;
-}
\ No newline at end of file
+}
+
+static jintArray newJIntArray(JNIEnv *env, const std::vector<jint> &values) {
+    jintArray array = env->NewIntArray(values.size());
+    env->SetIntArrayRegion(array, 0, values.size(), values.data());
+    return array;
+}
+
+static jfloatArray newJFloatArray(JNIEnv *env, const std::vector<jfloat> &values) {
+    jfloatArray array = env->NewFloatArray(values.size());
+    env->SetFloatArrayRegion(array, 0, values.size(), values.data());
+    return array;
+}
+
+static jdoubleArray newJDoubleArray(JNIEnv *env, const std::vector<jdouble> &values) {
+    jdoubleArray array = env->NewDoubleArray(values.size());
+    env->SetDoubleArrayRegion(array, 0, values.size(), values.data());
+    return array;
+}
+
+//4 points (8 ints) per box
+static void appendBoxPoints(std::vector<jint> &boxPoints, const std::vector<cv::Point> &boxPoint) {
+    for (int p = 0; p < 4; ++p) {
+        cv::Point point = p < boxPoint.size() ? boxPoint[p] : cv::Point();
+        boxPoints.emplace_back(point.x);
+        boxPoints.emplace_back(point.y);
+    }
+}
+
+jobject OcrResultUtils::getFlatResult(OcrResult &ocrResult, jobject boxImg) {
+    std::vector<TextBlock> &textBlocks = ocrResult.textBlocks;
+    int size = textBlocks.size();
+    std::vector<jint> boxPoints, angleIndexes, charScoreOffsets;
+    std::vector<jfloat> boxScores, angleScores, charScores;
+    std::vector<jdouble> times;
+    boxPoints.reserve(size * 8);
+    charScoreOffsets.emplace_back(0);
+    jobjectArray jTexts = jniEnv->NewObjectArray(size, jniIds.stringClass, NULL);
+    for (int i = 0; i < size; ++i) {
+        TextBlock &textBlock = textBlocks[i];
+        appendBoxPoints(boxPoints, textBlock.boxPoint);
+        boxScores.emplace_back(textBlock.boxScore);
+        angleIndexes.emplace_back(textBlock.angleIndex);
+        angleScores.emplace_back(textBlock.angleScore);
+        times.emplace_back(textBlock.angleTime);
+        times.emplace_back(textBlock.crnnTime);
+        times.emplace_back(textBlock.blockTime);
+        charScores.insert(charScores.end(), textBlock.charScores.begin(), textBlock.charScores.end());
+        charScoreOffsets.emplace_back(charScores.size());
+        jstring jText = jniEnv->NewStringUTF(textBlock.text.c_str());
+        jniEnv->SetObjectArrayElement(jTexts, i, jText);
+        jniEnv->DeleteLocalRef(jText);
+    }
+    std::vector<jint> skippedBoxPoints;
+    std::vector<jfloat> skippedBoxScores;
+    for (auto &textBox : ocrResult.skippedBoxes) {
+        appendBoxPoints(skippedBoxPoints, textBox.boxPoint);
+        skippedBoxScores.emplace_back(textBox.score);
+    }
+
+    JNIEnv *env = jniEnv;
+    jintArray jBoxPoints = newJIntArray(env, boxPoints);
+    jfloatArray jBoxScores = newJFloatArray(env, boxScores);
+    jintArray jAngleIndexes = newJIntArray(env, angleIndexes);
+    jfloatArray jAngleScores = newJFloatArray(env, angleScores);
+    jdoubleArray jTimes = newJDoubleArray(env, times);
+    jfloatArray jCharScores = newJFloatArray(env, charScores);
+    jintArray jCharScoreOffsets = newJIntArray(env, charScoreOffsets);
+    jintArray jSkippedBoxPoints = newJIntArray(env, skippedBoxPoints);
+    jfloatArray jSkippedBoxScores = newJFloatArray(env, skippedBoxScores);
+    return env->NewObject(jniIds.flatResultClass, jniIds.flatResultConstructor,
+                          (jdouble) ocrResult.dbNetTime, (jdouble) ocrResult.detectTime, boxImg,
+                          jBoxPoints, jBoxScores, jAngleIndexes, jAngleScores, jTimes, jTexts,
+                          jCharScores, jCharScoreOffsets, (jint) ocrResult.cacheHits,
+                          (jint) ocrResult.cacheMisses, (jboolean) ocrResult.partial,
+                          jSkippedBoxPoints, jSkippedBoxScores);
+}
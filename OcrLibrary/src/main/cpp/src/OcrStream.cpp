@@ -0,0 +1,128 @@
+#include "OcrStream.h"
+#include "OcrLite.h"
+#include "OcrUtils.h"
+#include "Trace.h"
+
+OcrStream::OcrStream(OcrLite *ocrLite, int queueSize)
+        : ocrLite(ocrLite), inputQueue(queueSize), detectedQueue(queueSize), outputQueue(queueSize) {
+    startTime = getCurrentTime();
+    detectBusyTime = 0.0;
+    recognizeBusyTime = 0.0;
+    frameCount = 0;
+    nextFrameId = 0;
+    detectThread = std::thread(&OcrStream::detectLoop, this);
+    recognizeThread = std::thread(&OcrStream::recognizeLoop, this);
+}
+
+OcrStream::~OcrStream() {
+    close();
+    if (detectThread.joinable()) detectThread.join();
+    if (recognizeThread.joinable()) recognizeThread.join();
+}
+
+long OcrStream::push(OcrFrame frame) {
+    long id = nextFrameId++;
+    frame.id = id;
+    return inputQueue.push(std::move(frame)) ? id : -1;
+}
+
+bool OcrStream::pop(long &frameId, OcrResult &result) {
+    std::pair<long, OcrResult> item;
+    if (!outputQueue.pop(item)) return false;
+    frameId = item.first;
+    result = std::move(item.second);
+    return true;
+}
+
+void OcrStream::finish() {
+    inputQueue.close();
+}
+
+void OcrStream::close() {
+    inputQueue.close();
+    detectedQueue.close();
+    outputQueue.close();
+}
+
+void OcrStream::detectLoop() {
+    setTraceThreadName("streamDetect");
+    OcrFrame frame;
+    while (inputQueue.pop(frame)) {
+        double start = getCurrentTime();
+        try {
+            ocrLite->detectTextBoxes(frame);
+        } catch (std::exception &e) {
+            LOGE("stream frame(%ld) detect failed: %s", frame.id, e.what());
+            //no workspace marks the frame failed for recognizeLoop
+            frame.workspace.reset();
+        }
+        detectBusyTime = detectBusyTime + (getCurrentTime() - start);
+        if (!detectedQueue.push(std::move(frame))) break;
+    }
+    detectedQueue.close();
+}
+
+void OcrStream::recognizeLoop() {
+    setTraceThreadName("streamRecognize");
+    OcrFrame frame;
+    while (detectedQueue.pop(frame)) {
+        double start = getCurrentTime();
+        //a failed frame still comes out, empty and partial, so callers waiting for its id go on
+        OcrResult result{};
+        result.partial = true;
+        if (frame.workspace) {
+            try {
+                result = ocrLite->recognizeTextBoxes(frame);
+            } catch (std::exception &e) {
+                LOGE("stream frame(%ld) recognize failed: %s", frame.id, e.what());
+            }
+        }
+        recognizeBusyTime = recognizeBusyTime + (getCurrentTime() - start);
+        frameCount++;
+        if (!outputQueue.push(std::make_pair(frame.id, std::move(result)))) break;
+    }
+    outputQueue.close();
+}
+
+OcrStreamStats OcrStream::getStats() {
+    double elapsed = getCurrentTime() - startTime;
+    OcrStreamStats stats;
+    stats.detectOccupancy = elapsed > 0 ? detectBusyTime / elapsed : 0.0;
+    stats.recognizeOccupancy = elapsed > 0 ? recognizeBusyTime / elapsed : 0.0;
+    stats.inputQueueDepth = inputQueue.getMeanDepth();
+    stats.detectedQueueDepth = detectedQueue.getMeanDepth();
+    stats.outputQueueDepth = outputQueue.getMeanDepth();
+    stats.frames = frameCount;
+    stats.framesPerSecond = elapsed > 0 ? frameCount * 1000.0 / elapsed : 0.0;
+    return stats;
+}
+
+OcrStreamSlot::OcrStreamSlot(OcrLite *ocrLite) : ocrLite(ocrLite) {}
+
+OcrStreamSlot::~OcrStreamSlot() {
+    stop();
+}
+
+void OcrStreamSlot::start(int queueSize) {
+    replace(std::make_shared<OcrStream>(ocrLite, queueSize));
+}
+
+void OcrStreamSlot::stop() {
+    replace(nullptr);
+}
+
+std::shared_ptr<OcrStream> OcrStreamSlot::get() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stream;
+}
+
+void OcrStreamSlot::replace(std::shared_ptr<OcrStream> next) {
+    std::shared_ptr<OcrStream> previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        previous.swap(stream);
+        stream = std::move(next);
+    }
+    //the last holder joins its threads, here or when its pending push or pop returns
+    if (previous) previous->close();
+}
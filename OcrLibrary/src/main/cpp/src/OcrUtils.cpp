@@ -1,4 +1,6 @@
 #include <opencv2/imgproc.hpp>
+#include <cstdio>
+#include <malloc.h>
 #include "OcrUtils.h"
 #include "clipper.hpp"
 
@@ -6,6 +8,19 @@ double getCurrentTime() {
     return (static_cast<double>(cv::getTickCount())) / cv::getTickFrequency() * 1000;//单位毫秒
 }
 
+long getHeapInUse() {
+#if defined(__ANDROID__)
+    //jemalloc and scudo count every allocation in uordblks
+    return (long) mallinfo().uordblks;
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+    return (long) (info.uordblks + info.hblkhd);
+#else
+    struct mallinfo info = mallinfo();
+    return (long) info.uordblks + (long) info.hblkhd;
+#endif
+}
+
 ScaleParam getScaleParam(cv::Mat &src, const float scale) {
     int srcWidth = src.cols;
     int srcHeight = src.rows;
@@ -25,9 +40,13 @@ ScaleParam getScaleParam(cv::Mat &src, const float scale) {
 }
 
 ScaleParam getScaleParam(cv::Mat &src, const int targetSize) {
+    return getScaleParam(src, 0, targetSize);
+}
+
+ScaleParam getScaleParam(cv::Mat &src, int padding, const int targetSize) {
     int srcWidth, srcHeight, dstWidth, dstHeight;
-    srcWidth = dstWidth = src.cols;
-    srcHeight = dstHeight = src.rows;
+    srcWidth = dstWidth = src.cols + 2 * padding;
+    srcHeight = dstHeight = src.rows + 2 * padding;
 
     float scale = 1.f;
     if (dstWidth > dstHeight) {
@@ -49,7 +68,7 @@ ScaleParam getScaleParam(cv::Mat &src, const int targetSize) {
     }
     float scaleWidth = (float) dstWidth / (float) srcWidth;
     float scaleHeight = (float) dstHeight / (float) srcHeight;
-    return {srcWidth, srcHeight, dstWidth, dstHeight, scaleWidth, scaleHeight};
+    return {srcWidth, srcHeight, dstWidth, dstHeight, scaleWidth, scaleHeight, padding};
 }
 
 cv::RotatedRect getPartRect(std::vector<cv::Point> &box, float scaleWidth, float scaleHeight) {
@@ -88,17 +107,19 @@ void drawTextBox(cv::Mat &boxImg, cv::RotatedRect &rect, int thickness) {
     //cv::polylines(srcmat, textpoint, true, cv::Scalar(0, 255, 0), 2);
 }
 
-void drawTextBox(cv::Mat &boxImg, const std::vector<cv::Point> &box, int thickness) {
-    auto color = cv::Scalar(0, 0, 255);// B(0) G(0) R(255)
-    cv::line(boxImg, box[0], box[1], color, thickness);
-    cv::line(boxImg, box[1], box[2], color, thickness);
-    cv::line(boxImg, box[2], box[3], color, thickness);
-    cv::line(boxImg, box[3], box[0], color, thickness);
+void drawTextBox(cv::Mat &boxImg, const std::vector<cv::Point> &box, int thickness,
+                 const cv::Point &offset, const cv::Scalar &color) {
+    cv::line(boxImg, box[0] - offset, box[1] - offset, color, thickness);
+    cv::line(boxImg, box[1] - offset, box[2] - offset, color, thickness);
+    cv::line(boxImg, box[2] - offset, box[3] - offset, color, thickness);
+    cv::line(boxImg, box[3] - offset, box[0] - offset, color, thickness);
 }
 
-void drawTextBoxes(cv::Mat &boxImg, std::vector<TextBox> &textBoxes, int thickness) {
+void drawTextBoxes(cv::Mat &boxImg, std::vector<TextBox> &textBoxes, int thickness, const cv::Point &offset) {
+    cv::Scalar color = boxImg.channels() == 4 ? cv::Scalar(255, 0, 0, 255) // R(255) G(0) B(0) A(255)
+                                              : cv::Scalar(0, 0, 255);// B(0) G(0) R(255)
     for (int i = 0; i < textBoxes.size(); ++i) {
-        drawTextBox(boxImg, textBoxes[i].boxPoint, thickness);
+        drawTextBox(boxImg, textBoxes[i].boxPoint, thickness, offset, color);
     }
 }
 
@@ -114,9 +135,7 @@ cv::Mat matRotateClockWise90(cv::Mat src) {
     return src;
 }
 
-cv::Mat getRotateCropImage(const cv::Mat &src, std::vector<cv::Point> box) {
-    cv::Mat image;
-    src.copyTo(image);
+cv::Mat getRotateCropImage(const cv::Mat &src, std::vector<cv::Point> box, cv::MatAllocator *allocator) {
     std::vector<cv::Point> points = box;
 
     int collectX[4] = {box[0].x, box[1].x, box[2].x, box[3].x};
@@ -126,8 +145,8 @@ cv::Mat getRotateCropImage(const cv::Mat &src, std::vector<cv::Point> box) {
     int top = int(*std::min_element(collectY, collectY + 4));
     int bottom = int(*std::max_element(collectY, collectY + 4));
 
-    cv::Mat imgCrop;
-    image(cv::Rect(left, top, right - left, bottom - top)).copyTo(imgCrop);
+    //the warp reads the box region in place, no copy of src
+    cv::Mat imgCrop = src(cv::Rect(left, top, right - left, bottom - top));
 
     for (int i = 0; i < points.size(); i++) {
         points[i].x -= left;
@@ -154,12 +173,14 @@ cv::Mat getRotateCropImage(const cv::Mat &src, std::vector<cv::Point> box) {
     cv::Mat M = cv::getPerspectiveTransform(ptsSrc, ptsDst);
 
     cv::Mat partImg;
+    partImg.allocator = allocator;
     cv::warpPerspective(imgCrop, partImg, M,
                         cv::Size(imgCropWidth, imgCropHeight),
                         cv::BORDER_REPLICATE);
 
     if (float(partImg.rows) >= float(partImg.cols) * 1.5) {
-        cv::Mat srcCopy = cv::Mat(partImg.rows, partImg.cols, partImg.depth());
+        cv::Mat srcCopy;
+        srcCopy.allocator = allocator;
         cv::transpose(partImg, srcCopy);
         cv::flip(srcCopy, srcCopy, 0);
         return srcCopy;
@@ -168,12 +189,16 @@ cv::Mat getRotateCropImage(const cv::Mat &src, std::vector<cv::Point> box) {
     }
 }
 
-cv::Mat adjustTargetImg(cv::Mat &src, int dstWidth, int dstHeight) {
+cv::Mat adjustTargetImg(cv::Mat &src, int dstWidth, int dstHeight, cv::MatAllocator *allocator) {
     cv::Mat srcResize;
+    srcResize.allocator = allocator;
     float scale = (float) dstHeight / (float) src.rows;
     int angleWidth = int((float) src.cols * scale);
     cv::resize(src, srcResize, cv::Size(angleWidth, dstHeight));
-    cv::Mat srcFit = cv::Mat(dstHeight, dstWidth, CV_8UC3, cv::Scalar(255, 255, 255));
+    cv::Mat srcFit;
+    srcFit.allocator = allocator;
+    srcFit.create(dstHeight, dstWidth, CV_8UC3);
+    srcFit.setTo(cv::Scalar(255, 255, 255));
     if (angleWidth < dstWidth) {
         cv::Rect rect(0, 0, srcResize.cols, srcResize.rows);
         srcResize.copyTo(srcFit(rect));
@@ -292,9 +317,43 @@ cv::RotatedRect unClip(std::vector<cv::Point2f> box, float unClipRatio) {
     return res;
 }
 
+//Hash of a coarse (1/4 scale, 16 gray levels) copy of src, tolerant to sensor noise
+uint64_t getMatFingerprint(const cv::Mat &src) {
+    cv::Mat small, gray;
+    cv::resize(src, small, cv::Size((std::max)(src.cols / 4, 1), (std::max)(src.rows / 4, 1)), 0, 0,
+               cv::INTER_AREA);
+    if (small.channels() == 3) {
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        gray = small;
+    }
+    uint64_t hash = 14695981039346656037ULL;//FNV-1a
+    auto mix = [&hash](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+    mix(uint64_t(src.cols));
+    mix(uint64_t(src.rows));
+    for (int r = 0; r < gray.rows; ++r) {
+        const uchar *row = gray.ptr<uchar>(r);
+        for (int c = 0; c < gray.cols; ++c) {
+            mix(row[c] >> 4);
+        }
+    }
+    return hash;
+}
+
 std::vector<float> substractMeanNormalize(cv::Mat &src, const float *meanVals, const float *normVals) {
+    std::vector<float> inputTensorValues;
+    substractMeanNormalize(src, meanVals, normVals, inputTensorValues);
+    return inputTensorValues;
+}
+
+void substractMeanNormalize(cv::Mat &src, const float *meanVals, const float *normVals,
+                            std::vector<float> &inputTensorValues) {
     auto inputTensorSize = src.cols * src.rows * src.channels();
-    std::vector<float> inputTensorValues(inputTensorSize);
+    //keeps the capacity of a reused vector
+    inputTensorValues.resize(inputTensorSize);
     size_t numChannels = src.channels();
     size_t imageSize = src.cols * src.rows;
 
@@ -304,7 +363,32 @@ std::vector<float> substractMeanNormalize(cv::Mat &src, const float *meanVals, c
             inputTensorValues[ch * imageSize + pid] = data;
         }
     }
-    return inputTensorValues;
+}
+
+void substractMeanNormalize(cv::Mat &src, int left, int top, int dstWidth, int dstHeight,
+                            const float *meanVals, const float *normVals, std::vector<float> &inputTensorValues) {
+    size_t numChannels = src.channels();
+    size_t imageSize = dstWidth * dstHeight;
+    inputTensorValues.resize(imageSize * numChannels);
+
+    for (size_t ch = 0; ch < numChannels; ++ch) {
+        float *plane = inputTensorValues.data() + ch * imageSize;
+        float white = (float) (255 * normVals[ch] - meanVals[ch] * normVals[ch]);
+        for (int y = 0; y < dstHeight; ++y) {
+            float *row = plane + y * dstWidth;
+            int srcY = y - top;
+            if (srcY < 0 || srcY >= src.rows) {
+                std::fill(row, row + dstWidth, white);
+                continue;
+            }
+            const uchar *srcRow = src.ptr<uchar>(srcY);
+            std::fill(row, row + left, white);
+            for (int x = 0; x < src.cols; ++x) {
+                row[left + x] = (float) (srcRow[x * numChannels + ch] * normVals[ch] - meanVals[ch] * normVals[ch]);
+            }
+            std::fill(row + left + src.cols, row + dstWidth, white);
+        }
+    }
 }
 
 std::vector<int> getAngleIndexes(std::vector<Angle> &angles) {
@@ -377,24 +461,45 @@ std::vector<Ort::AllocatedStringPtr> getOutputNames(Ort::Session *session) {
     return outputNamesPtr;
 }
 
-void *getModelDataFromAssets(AAssetManager *mgr, const char *modelName, int &size) {
-    if (mgr == NULL) {
-        LOGE(" %s", "AAssetManager==NULL");
-        return NULL;
-    }
-    AAsset *asset = AAssetManager_open(mgr, modelName, AASSET_MODE_UNKNOWN);
-    if (asset == NULL) {
-        LOGE(" %s", "asset==NULL");
+static void *getModelDataFromFile(const char *path, int &size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        LOGE("open %s failed", path);
         return NULL;
     }
-    off_t bufferSize = AAsset_getLength(asset);
-    void *modelData = malloc(bufferSize + 1);
-    size = AAsset_read(asset, modelData, bufferSize);
-    AAsset_close(asset);
-    LOGI("model=%s, numBytesRead=%d", modelName, size);
+    fseek(file, 0, SEEK_END);
+    long bufferSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *modelData = (char *) malloc(bufferSize + 1);
+    size = fread(modelData, 1, bufferSize, file);
+    modelData[size] = 0;
+    fclose(file);
+    LOGI("model=%s, numBytesRead=%d", path, size);
     return modelData;
 }
 
+void *getModelDataFromAssets(AAssetManager *mgr, const char *modelName, int &size) {
+#ifdef __ANDROID__
+    if (mgr != NULL) {
+        AAsset *asset = AAssetManager_open(mgr, modelName, AASSET_MODE_UNKNOWN);
+        if (asset == NULL) {
+            LOGE(" %s", "asset==NULL");
+            return NULL;
+        }
+        off_t bufferSize = AAsset_getLength(asset);
+        char *modelData = (char *) malloc(bufferSize + 1);
+        size = AAsset_read(asset, modelData, bufferSize);
+        modelData[(std::max)(size, 0)] = 0;
+        AAsset_close(asset);
+        LOGI("model=%s, numBytesRead=%d", modelName, size);
+        return modelData;
+    }
+#endif
+    return getModelDataFromFile(modelName, size);
+}
+
+#ifdef __ANDROID__
+
 std::string jstringTostring(JNIEnv *env, jstring input) {
     char *str = NULL;
     jclass clsstring = env->FindClass("java/lang/String");
@@ -409,6 +514,26 @@ std::string jstringTostring(JNIEnv *env, jstring input) {
         str[alen] = 0;
     }
     env->ReleaseByteArrayElements(barr, ba, 0);
+    if (str == NULL) return "";
     std::string ret = str;
+    free(str);
     return ret;
+}
+
+#endif
+
+std::vector<std::string> splitUtf8(const std::string &str) {
+    std::vector<std::string> chars;
+    size_t i = 0;
+    while (i < str.size()) {
+        unsigned char c = str[i];
+        size_t len = 1;
+        if ((c & 0xE0) == 0xC0) len = 2;
+        else if ((c & 0xF0) == 0xE0) len = 3;
+        else if ((c & 0xF8) == 0xF0) len = 4;
+        len = (std::min)(len, str.size() - i);
+        chars.emplace_back(str.substr(i, len));
+        i += len;
+    }
+    return chars;
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "OrtProfiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+void OrtProfiler::setModel(AAssetManager *assetManager, const std::string &modelName) {
+    mgr = assetManager;
+    name = modelName;
+}
+
+bool OrtProfiler::start(Ort::Env &env, Ort::SessionOptions &options, const std::string &prefix, int runs) {
+    if (runs <= 0) return false;
+    int size = 0;
+    void *modelData = getModelDataFromAssets(mgr, name.c_str(), size);
+    if (modelData == NULL) return false;
+    std::shared_ptr<Ort::Session> profiling;
+    try {
+        Ort::SessionOptions profilingOptions = options.Clone();
+        profilingOptions.EnableProfiling(prefix.c_str());
+        profiling = std::make_shared<Ort::Session>(env, modelData, size, profilingOptions);
+    } catch (Ort::Exception &e) {
+        LOGW("profiling session of %s failed: %s", name.c_str(), e.what());
+    }
+    free(modelData);
+    if (!profiling) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    session = profiling;
+    runsPending = 0;
+    runsLeft = runs;
+    return true;
+}
+
+std::shared_ptr<Ort::Session> OrtProfiler::take() {
+    if (runsLeft.load(std::memory_order_relaxed) <= 0) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (runsLeft <= 0 || !session) return nullptr;
+    runsLeft--;
+    runsPending++;
+    return session;
+}
+
+//kernel time events of the ORT profile, one event per line:
+//{"cat" : "Node", ..., "dur" :13, ..., "name" :"Conv_0_kernel_time", "args" : {..., "op_name" : "Conv", ...}}
+static bool getJsonValue(const std::string &line, const char *key, std::string &value) {
+    size_t pos = line.find(std::string("\"") + key + "\"");
+    if (pos == std::string::npos) return false;
+    pos = line.find(':', pos);
+    if (pos == std::string::npos) return false;
+    pos = line.find_first_not_of(" ", pos + 1);
+    if (pos == std::string::npos) return false;
+    if (line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(pos + 1, end - pos - 1);
+    } else {
+        size_t end = line.find_first_of(",}", pos);
+        value = line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+    return true;
+}
+
+static std::vector<OpProfile> readOpProfiles(const std::string &file) {
+    std::ifstream in(file);
+    std::map<std::string, OpProfile> byType;
+    std::string line, eventName, opType, duration;
+    const std::string kernelTime = "_kernel_time";
+    while (std::getline(in, line)) {
+        if (!getJsonValue(line, "name", eventName) || eventName.size() < kernelTime.size() ||
+            eventName.compare(eventName.size() - kernelTime.size(), kernelTime.size(), kernelTime) != 0) {
+            continue;
+        }
+        if (!getJsonValue(line, "op_name", opType) || !getJsonValue(line, "dur", duration)) continue;
+        OpProfile &profile = byType[opType];
+        profile.opType = opType;
+        profile.calls++;
+        profile.time += atof(duration.c_str()) / 1000.0;//us
+    }
+    std::vector<OpProfile> opProfiles;
+    for (auto &it : byType) {
+        opProfiles.emplace_back(it.second);
+    }
+    std::sort(opProfiles.begin(), opProfiles.end(), [](const OpProfile &a, const OpProfile &b) {
+        return a.time > b.time;
+    });
+    return opProfiles;
+}
+
+void OrtProfiler::finish(const std::shared_ptr<Ort::Session> &finished) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        //runs of a profile replaced by start() are dropped with it
+        if (finished != session || --runsPending > 0 || runsLeft > 0) return;
+        session.reset();
+    }
+    Ort::AllocatorWithDefaultOptions allocator;
+    std::string file;
+    try {
+        file = finished->EndProfilingAllocated(allocator).get();
+    } catch (Ort::Exception &e) {
+        LOGW("end profiling of %s failed: %s", name.c_str(), e.what());
+        return;
+    }
+    std::vector<OpProfile> profiles = readOpProfiles(file);
+    Logger("profile of %s: %s, %ld op types", name.c_str(), file.c_str(), profiles.size());
+    std::lock_guard<std::mutex> lock(mutex);
+    opProfiles = profiles;
+    profileFile = file;
+}
+
+std::vector<OpProfile> OrtProfiler::getOpProfiles() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return opProfiles;
+}
+
+std::string OrtProfiler::getProfileFile() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return profileFile;
+}
+
+OrtProfiler::Run::Run(OrtProfiler &profiler) : profiler(profiler), profiled(profiler.take()) {}
+
+OrtProfiler::Run::~Run() {
+    if (profiled) profiler.finish(profiled);
+}
+
+Ort::Session *OrtProfiler::Run::session(Ort::Session *normal) {
+    return profiled ? profiled.get() : normal;
+}
+
+std::string formatOpProfiles(const std::string &title, const std::vector<OpProfile> &opProfiles, int topK) {
+    double total = 0.0;
+    for (auto &profile : opProfiles) total += profile.time;
+    std::string text = title + "\n";
+    char line[160];
+    for (int i = 0; i < opProfiles.size() && i < topK; ++i) {
+        const OpProfile &profile = opProfiles[i];
+        snprintf(line, sizeof(line), "  %-24s %8ld %10.2fms %6.1f%%\n", profile.opType.c_str(), profile.calls,
+                 profile.time, total > 0 ? profile.time * 100.0 / total : 0.0);
+        text += line;
+    }
+    return text;
+}
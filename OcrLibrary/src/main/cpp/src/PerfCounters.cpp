@@ -0,0 +1,165 @@
+#include "PerfCounters.h"
+#include "OcrUtils.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#define PERF_COUNTERS_SUPPORTED
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+static std::atomic<bool> perfEnabled(false);
+
+#ifdef PERF_COUNTERS_SUPPORTED
+
+//in PerfSample order
+static const uint64_t perfEvents[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+static const int perfEventCount = sizeof(perfEvents) / sizeof(perfEvents[0]);
+
+//one group per thread led by cycles, events[i] is the PerfSample field of fds[i]
+struct ThreadCounters {
+    int tid;
+    std::vector<int> fds;
+    std::vector<int> events;
+};
+
+static std::mutex perfMutex;
+static std::vector<ThreadCounters> perfThreads;
+
+static int openPerfEvent(int tid, int event, int groupFd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = perfEvents[event];
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, tid, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+//false without a cycles counter, other events the cpu lacks are left out
+static bool openThreadCounters(int tid) {
+    int leader = openPerfEvent(tid, 0, -1);
+    if (leader < 0) return false;
+    ThreadCounters counters{tid, {leader}, {0}};
+    for (int event = 1; event < perfEventCount; ++event) {
+        int fd = openPerfEvent(tid, event, leader);
+        if (fd < 0) continue;
+        counters.fds.push_back(fd);
+        counters.events.push_back(event);
+    }
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    perfThreads.push_back(counters);
+    return true;
+}
+
+//ort pools and box workers start at init, so this finds nothing new in steady state
+static void openNewThreads() {
+    DIR *dp = opendir("/proc/self/task");
+    if (dp == NULL) return;
+    while (dirent *entry = readdir(dp)) {
+        int tid = atoi(entry->d_name);
+        if (tid <= 0) continue;
+        bool known = false;
+        for (auto &counters : perfThreads) {
+            if (counters.tid == tid) {
+                known = true;
+                break;
+            }
+        }
+        if (!known) openThreadCounters(tid);
+    }
+    closedir(dp);
+}
+
+//counts are scaled up when the group was multiplexed with other perf users
+static void readThreadCounters(const ThreadCounters &counters, long *values) {
+    uint64_t buffer[3 + perfEventCount];//nr, time enabled, time running, values
+    ssize_t size = read(counters.fds[0], buffer, sizeof(buffer));
+    if (size < (ssize_t) ((3 + counters.fds.size()) * sizeof(uint64_t)) || buffer[2] == 0) return;
+    double scale = (double) buffer[1] / (double) buffer[2];
+    for (int i = 0; i < counters.events.size(); ++i) {
+        values[counters.events[i]] += (long) ((double) buffer[3 + i] * scale);
+    }
+}
+
+static void closeThreadCounters() {
+    for (auto &counters : perfThreads) {
+        for (int fd : counters.fds) close(fd);
+    }
+    perfThreads.clear();
+}
+
+bool startPerfCounters() {
+    std::lock_guard<std::mutex> lock(perfMutex);
+    closeThreadCounters();
+    if (!openThreadCounters((int) syscall(SYS_gettid))) {
+        LOGW("perf counters not available: %s", strerror(errno));
+        return false;
+    }
+    openNewThreads();
+    perfEnabled = true;
+    return true;
+}
+
+void stopPerfCounters() {
+    std::lock_guard<std::mutex> lock(perfMutex);
+    perfEnabled = false;
+    closeThreadCounters();
+}
+
+PerfSample readPerfCounters() {
+    if (!isPerfCountersEnabled()) return {};
+    std::lock_guard<std::mutex> lock(perfMutex);
+    openNewThreads();
+    long values[perfEventCount] = {0};
+    for (auto &counters : perfThreads) {
+        readThreadCounters(counters, values);
+    }
+    return {values[0], values[1], values[2], values[3]};
+}
+
+#else
+
+bool startPerfCounters() {
+    return false;
+}
+
+void stopPerfCounters() {}
+
+PerfSample readPerfCounters() {
+    return {};
+}
+
+#endif
+
+bool isPerfCountersEnabled() {
+    return perfEnabled.load(std::memory_order_relaxed);
+}
+
+void addPerfSample(PerfSample &sum, const PerfSample &start, const PerfSample &end) {
+    //stopped in between
+    if (end.cycles < start.cycles) return;
+    sum.cycles += end.cycles - start.cycles;
+    sum.instructions += end.instructions - start.instructions;
+    sum.cacheMisses += end.cacheMisses - start.cacheMisses;
+    sum.branchMisses += end.branchMisses - start.branchMisses;
+}
+
+PerfScope::PerfScope(PerfSample &sum) : sum(sum), enabled(isPerfCountersEnabled()), start(readPerfCounters()) {}
+
+PerfScope::~PerfScope() {
+    if (enabled) addPerfSample(sum, start, readPerfCounters());
+}
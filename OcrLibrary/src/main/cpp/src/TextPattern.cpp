@@ -0,0 +1,442 @@
+#include "TextPattern.h"
+#include <algorithm>
+
+enum {
+    NODE_EMPTY = 0,
+    NODE_CLASS,
+    NODE_CONCAT,
+    NODE_ALT,
+    NODE_REPEAT
+};
+
+const int STATE_EPSILON = -1;
+const int STATE_MATCH = -2;
+//subset construction blows up on patterns like (a|b)*a(a|b){20}, those are refused
+const int MAX_DFA_STATES = 4096;
+
+TextPattern::TextPattern() {}
+
+TextPattern::~TextPattern() {}
+
+bool TextPattern::compile(const std::string &pattern, const std::vector<std::string> &keys) {
+    src = pattern;
+    pos = 0;
+    ok = false;
+    keyList = &keys;
+    keyIndexes.clear();
+    classes.clear();
+    nfa.clear();
+    dfaSets.clear();
+    dfaIds.clear();
+    dfaTrans.clear();
+    dfaAccept.clear();
+    if (pattern.empty()) return false;
+    //index 0 is the ctc blank
+    for (int i = 1; i < keys.size(); ++i) {
+        keyIndexes.emplace(keys[i], i);
+    }
+
+    Node root;
+    if (!parseAlt(root) || pos != src.size()) return false;
+
+    int match = newState(STATE_MATCH, {});
+    nfaStart = compileNode(root, match);
+
+    //state 0 is the start, every state found is expanded in turn
+    std::vector<int> set;
+    std::vector<bool> visited(nfa.size(), false);
+    closure(nfaStart, set, visited);
+    getDfaState(set);
+    for (int state = 0; state < dfaSets.size(); ++state) {
+        if (dfaSets.size() > MAX_DFA_STATES) return false;
+        buildTransitions(state);
+    }
+    ok = true;
+    return true;
+}
+
+bool TextPattern::empty() const {
+    return !ok;
+}
+
+const std::string &TextPattern::getPattern() const {
+    return src;
+}
+
+bool TextPattern::getLuhnCheck() const {
+    return luhnCheck;
+}
+
+void TextPattern::setLuhnCheck(bool check) {
+    luhnCheck = check;
+}
+
+bool TextPattern::nextCodePoint(unsigned int &cp, std::string &ch) {
+    if (pos >= src.size()) return false;
+    unsigned char c = src[pos];
+    size_t len = 1;
+    cp = c;
+    if ((c & 0xE0) == 0xC0) {
+        len = 2;
+        cp = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        len = 3;
+        cp = c & 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+        len = 4;
+        cp = c & 0x07;
+    }
+    if (pos + len > src.size()) return false;
+    for (size_t i = 1; i < len; ++i) {
+        cp = (cp << 6) | (src[pos + i] & 0x3F);
+    }
+    ch = src.substr(pos, len);
+    pos += len;
+    return true;
+}
+
+static std::string codePointToUtf8(unsigned int cp) {
+    std::string out;
+    if (cp < 0x80) {
+        out += char(cp);
+    } else if (cp < 0x800) {
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    } else {
+        out += char(0xF0 | (cp >> 18));
+        out += char(0x80 | ((cp >> 12) & 0x3F));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+void TextPattern::addCodePoint(unsigned int cp, std::vector<int> &indexes) {
+    auto it = keyIndexes.find(codePointToUtf8(cp));
+    if (it != keyIndexes.end()) indexes.emplace_back(it->second);
+}
+
+void TextPattern::addChars(const std::string &chars, std::vector<int> &indexes) {
+    for (char c: chars) {
+        addCodePoint((unsigned char) c, indexes);
+    }
+}
+
+//alt := concat ('|' concat)*
+bool TextPattern::parseAlt(Node &node) {
+    node = Node{NODE_ALT};
+    while (true) {
+        Node concat;
+        if (!parseConcat(concat)) return false;
+        node.children.emplace_back(concat);
+        if (pos >= src.size() || src[pos] != '|') break;
+        ++pos;
+    }
+    if (node.children.size() == 1) {
+        Node child = node.children[0];
+        node = child;
+    }
+    return true;
+}
+
+//concat := repeat*
+bool TextPattern::parseConcat(Node &node) {
+    node = Node{NODE_CONCAT};
+    while (pos < src.size() && src[pos] != '|' && src[pos] != ')') {
+        Node repeat;
+        if (!parseRepeat(repeat)) return false;
+        node.children.emplace_back(repeat);
+    }
+    return true;
+}
+
+static bool parseInt(const std::string &s, size_t &pos, int &value) {
+    size_t start = pos;
+    value = 0;
+    while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') {
+        value = value * 10 + (s[pos] - '0');
+        ++pos;
+    }
+    return pos > start;
+}
+
+//repeat := atom ('?' | '*' | '+' | '{n}' | '{n,}' | '{n,m}')*
+bool TextPattern::parseRepeat(Node &node) {
+    if (!parseAtom(node)) return false;
+    while (pos < src.size()) {
+        int min, max;
+        char c = src[pos];
+        if (c == '?') {
+            min = 0;
+            max = 1;
+            ++pos;
+        } else if (c == '*') {
+            min = 0;
+            max = -1;
+            ++pos;
+        } else if (c == '+') {
+            min = 1;
+            max = -1;
+            ++pos;
+        } else if (c == '{') {
+            ++pos;
+            if (!parseInt(src, pos, min)) return false;
+            max = min;
+            if (pos < src.size() && src[pos] == ',') {
+                ++pos;
+                if (!parseInt(src, pos, max)) max = -1;
+            }
+            if (pos >= src.size() || src[pos] != '}') return false;
+            ++pos;
+            if (max != -1 && max < min) return false;
+        } else {
+            break;
+        }
+        Node repeat{NODE_REPEAT};
+        repeat.children.emplace_back(node);
+        repeat.min = min;
+        repeat.max = max;
+        node = repeat;
+    }
+    return true;
+}
+
+bool TextPattern::parseAtom(Node &node) {
+    char c = src[pos];
+    if (c == '(') {
+        ++pos;
+        if (src.compare(pos, 2, "?:") == 0) pos += 2;
+        if (!parseAlt(node)) return false;
+        if (pos >= src.size() || src[pos] != ')') return false;
+        ++pos;
+        return true;
+    }
+    if (c == '^' || c == '$') {
+        ++pos;
+        node = Node{NODE_EMPTY};
+        return true;
+    }
+    if (c == '[') {
+        ++pos;
+        return parseClass(node);
+    }
+    node = Node{NODE_CLASS};
+    if (c == '.') {
+        ++pos;
+        for (int i = 1; i < keyList->size(); ++i) {
+            node.indexes.emplace_back(i);
+        }
+        return true;
+    }
+    if (c == '\\') {
+        ++pos;
+        if (pos >= src.size()) return false;
+        char e = src[pos];
+        if (e == 'd') {
+            ++pos;
+            addChars("0123456789", node.indexes);
+            return true;
+        } else if (e == 'w') {
+            ++pos;
+            addChars("0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_", node.indexes);
+            return true;
+        } else if (e == 's') {
+            ++pos;
+            addChars(" ", node.indexes);
+            return true;
+        }
+    }
+    unsigned int cp;
+    std::string ch;
+    if (!nextCodePoint(cp, ch)) return false;
+    addCodePoint(cp, node.indexes);
+    return true;
+}
+
+//class := '^'? (char | char '-' char | escape)* ']'
+bool TextPattern::parseClass(Node &node) {
+    node = Node{NODE_CLASS};
+    bool negate = false;
+    if (pos < src.size() && src[pos] == '^') {
+        negate = true;
+        ++pos;
+    }
+    std::vector<int> indexes;
+    while (pos < src.size() && src[pos] != ']') {
+        unsigned int first, last;
+        std::string ch;
+        if (src[pos] == '\\') {
+            ++pos;
+            if (pos < src.size() && src[pos] == 'd') {
+                ++pos;
+                addChars("0123456789", indexes);
+                continue;
+            }
+        }
+        if (!nextCodePoint(first, ch)) return false;
+        last = first;
+        if (pos + 1 < src.size() && src[pos] == '-' && src[pos + 1] != ']') {
+            ++pos;
+            if (src[pos] == '\\') ++pos;
+            if (!nextCodePoint(last, ch) || last < first) return false;
+        }
+        for (unsigned int cp = first; cp <= last; ++cp) {
+            addCodePoint(cp, indexes);
+        }
+    }
+    if (pos >= src.size()) return false;
+    ++pos;
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    if (negate) {
+        for (int i = 1; i < keyList->size(); ++i) {
+            if (!std::binary_search(indexes.begin(), indexes.end(), i)) {
+                node.indexes.emplace_back(i);
+            }
+        }
+    } else {
+        node.indexes = indexes;
+    }
+    return true;
+}
+
+int TextPattern::newState(int classId, std::vector<int> outs) {
+    nfa.emplace_back(NfaState{classId, outs});
+    return int(nfa.size()) - 1;
+}
+
+//Builds the nfa backwards: returns the entry state of node, which continues at next
+int TextPattern::compileNode(const Node &node, int next) {
+    switch (node.type) {
+        case NODE_CLASS: {
+            classes.emplace_back(node.indexes);
+            return newState(int(classes.size()) - 1, {next});
+        }
+        case NODE_CONCAT: {
+            for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                next = compileNode(*it, next);
+            }
+            return next;
+        }
+        case NODE_ALT: {
+            std::vector<int> outs;
+            for (auto &child: node.children) {
+                outs.emplace_back(compileNode(child, next));
+            }
+            return newState(STATE_EPSILON, outs);
+        }
+        case NODE_REPEAT: {
+            const Node &child = node.children[0];
+            int cur = next;
+            if (node.max == -1) {
+                int loop = newState(STATE_EPSILON, {});
+                int body = compileNode(child, loop);
+                nfa[loop].outs = {body, next};
+                cur = loop;
+            } else {
+                for (int i = 0; i < node.max - node.min; ++i) {
+                    int body = compileNode(child, cur);
+                    cur = newState(STATE_EPSILON, {body, cur});
+                }
+            }
+            for (int i = 0; i < node.min; ++i) {
+                cur = compileNode(child, cur);
+            }
+            return cur;
+        }
+        default:
+            return next;
+    }
+}
+
+void TextPattern::closure(int state, std::vector<int> &set, std::vector<bool> &visited) {
+    if (visited[state]) return;
+    visited[state] = true;
+    if (nfa[state].classId == STATE_EPSILON) {
+        for (int out: nfa[state].outs) {
+            closure(out, set, visited);
+        }
+    } else {
+        set.emplace_back(state);
+    }
+}
+
+int TextPattern::getDfaState(std::vector<int> &set) {
+    std::sort(set.begin(), set.end());
+    auto it = dfaIds.find(set);
+    if (it != dfaIds.end()) return it->second;
+    int id = int(dfaSets.size());
+    bool accept = false;
+    for (int s: set) {
+        if (nfa[s].classId == STATE_MATCH) accept = true;
+    }
+    dfaSets.emplace_back(set);
+    dfaIds.emplace(set, id);
+    dfaTrans.emplace_back();
+    dfaAccept.emplace_back(accept);
+    return id;
+}
+
+int TextPattern::startState() const {
+    return 0;
+}
+
+const std::vector<std::pair<int, int>> &TextPattern::transitions(int state) const {
+    return dfaTrans[state];
+}
+
+void TextPattern::buildTransitions(int state) {
+    std::map<int, std::vector<int>> nextStates;
+    for (int s: dfaSets[state]) {
+        int classId = nfa[s].classId;
+        if (classId < 0) continue;
+        for (int index: classes[classId]) {
+            nextStates[index].emplace_back(nfa[s].outs[0]);
+        }
+    }
+    std::vector<std::pair<int, int>> trans;
+    for (auto &item: nextStates) {
+        std::vector<int> set;
+        std::vector<bool> visited(nfa.size(), false);
+        for (int s: item.second) {
+            closure(s, set, visited);
+        }
+        int next = getDfaState(set);
+        trans.emplace_back(item.first, next);
+    }
+    //getDfaState may grow dfaTrans, so index again after building
+    dfaTrans[state] = trans;
+}
+
+bool TextPattern::isAccept(int state) const {
+    return dfaAccept[state];
+}
+
+static bool isLuhnValid(const std::string &text) {
+    if (text.empty()) return false;
+    int sum = 0;
+    bool doubled = false;
+    for (auto it = text.rbegin(); it != text.rend(); ++it) {
+        if (*it < '0' || *it > '9') return false;
+        int digit = *it - '0';
+        if (doubled) {
+            digit *= 2;
+            if (digit > 9) digit -= 9;
+        }
+        sum += digit;
+        doubled = !doubled;
+    }
+    return sum % 10 == 0;
+}
+
+//only a 15 digit imei ending the text carries a check digit, a 17 digit imeisv or a label before it do not
+bool TextPattern::check(const std::string &text) const {
+    if (!luhnCheck) return true;
+    size_t start = text.find_last_not_of("0123456789");
+    std::string digits = start == std::string::npos ? text : text.substr(start + 1);
+    return digits.size() != 15 || isLuhnValid(digits);
+}
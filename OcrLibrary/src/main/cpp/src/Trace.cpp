@@ -0,0 +1,116 @@
+#include "Trace.h"
+#include "OcrUtils.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+//seq is the event index + 1 once the slot is written and 0 while a writer is in it
+struct TraceSlot {
+    std::atomic<unsigned long> seq;
+    std::atomic<const char *> name;
+    std::atomic<long> arg;
+    std::atomic<int> tid;
+    std::atomic<double> startTime;
+    std::atomic<double> endTime;
+};
+
+//static so late writers never see a freed ring, untouched pages cost no memory
+static TraceSlot traceSlots[TRACE_CAPACITY];
+static std::atomic<unsigned long> traceHead(0);
+static std::atomic<unsigned long> traceBase(0);//head at startTrace, older events are not exported
+static std::atomic<bool> traceEnabled(false);
+
+static std::mutex threadNamesMutex;
+static std::map<int, std::string> threadNames;
+
+static int getTraceTid() {
+    static thread_local int tid = (int) syscall(SYS_gettid);
+    return tid;
+}
+
+void startTrace() {
+    traceBase.store(traceHead.load());
+    traceEnabled.store(true);
+}
+
+void stopTrace() {
+    traceEnabled.store(false);
+}
+
+bool isTraceEnabled() {
+    return traceEnabled.load(std::memory_order_relaxed);
+}
+
+void setTraceThreadName(const std::string &name) {
+    std::lock_guard<std::mutex> lock(threadNamesMutex);
+    threadNames[getTraceTid()] = name;
+}
+
+void addTraceSpan(const char *name, long arg, double startTime, double endTime) {
+    if (!isTraceEnabled()) return;
+    unsigned long index = traceHead.fetch_add(1, std::memory_order_relaxed);
+    TraceSlot &slot = traceSlots[index & (TRACE_CAPACITY - 1)];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.tid.store(getTraceTid(), std::memory_order_relaxed);
+    slot.startTime.store(startTime, std::memory_order_relaxed);
+    slot.endTime.store(endTime, std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+std::string getChromeTrace() {
+    int pid = getpid();
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char buffer[256];
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(threadNamesMutex);
+        for (auto &threadName : threadNames) {
+            snprintf(buffer, sizeof(buffer),
+                     "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     first ? "" : ",", pid, threadName.first, threadName.second.c_str());
+            json += buffer;
+            first = false;
+        }
+    }
+    unsigned long head = traceHead.load(std::memory_order_acquire);
+    unsigned long base = traceBase.load();
+    unsigned long begin = head - base > TRACE_CAPACITY ? head - TRACE_CAPACITY : base;
+    for (unsigned long index = begin; index < head; ++index) {
+        TraceSlot &slot = traceSlots[index & (TRACE_CAPACITY - 1)];
+        //seqlock read: skip slots being written or already overwritten by a newer event
+        unsigned long seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != index + 1) continue;
+        const char *name = slot.name.load(std::memory_order_relaxed);
+        long arg = slot.arg.load(std::memory_order_relaxed);
+        int tid = slot.tid.load(std::memory_order_relaxed);
+        double startTime = slot.startTime.load(std::memory_order_relaxed);
+        double endTime = slot.endTime.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) continue;
+        int length = snprintf(buffer, sizeof(buffer),
+                              "%s{\"name\":\"%s\",\"cat\":\"ocr\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                              "\"ts\":%.3f,\"dur\":%.3f",
+                              first ? "" : ",", name, pid, tid, startTime * 1000.0,
+                              (std::max)(endTime - startTime, 0.0) * 1000.0);
+        if (arg >= 0 && length < (int) sizeof(buffer)) {
+            snprintf(buffer + length, sizeof(buffer) - length, ",\"args\":{\"arg\":%ld}", arg);
+        }
+        json += buffer;
+        json += "}";
+        first = false;
+    }
+    json += "]}";
+    return json;
+}
+
+TraceScope::TraceScope(const char *name, long arg)
+        : name(name), arg(arg), startTime(isTraceEnabled() ? getCurrentTime() : -1.0) {}
+
+TraceScope::~TraceScope() {
+    if (startTime >= 0.0) addTraceSpan(name, arg, startTime, getCurrentTime());
+}
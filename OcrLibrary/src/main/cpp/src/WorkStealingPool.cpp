@@ -0,0 +1,135 @@
+#include "WorkStealingPool.h"
+#include "OcrUtils.h"
+#include "Trace.h"
+
+WorkStealingPool::WorkStealingPool(int workerCount) {
+    nextWorker = 0;
+    startTime = getCurrentTime();
+    int count = (std::max)(workerCount, 1);
+    for (int i = 0; i < count; ++i) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->taskCount = 0;
+        worker->stealCount = 0;
+        worker->busyTime = 0.0;
+        workers.emplace_back(std::move(worker));
+    }
+    for (int i = 0; i < count; ++i) {
+        workers[i]->thread = std::thread(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (int i = 0; i < workers.size(); ++i) {
+        if (workers[i]->thread.joinable()) workers[i]->thread.join();
+    }
+}
+
+int WorkStealingPool::getWorkerCount() {
+    return workers.size();
+}
+
+void WorkStealingPool::run(std::vector<std::function<void()>> &tasks) {
+    if (tasks.empty()) return;
+    Batch batch;
+    batch.remaining = tasks.size();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued += tasks.size();
+    }
+    //round robin from a moving start, so concurrent callers do not all load worker 0
+    unsigned first = nextWorker.fetch_add(1);
+    for (int i = 0; i < tasks.size(); ++i) {
+        Worker &worker = *workers[(first + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(Task{&tasks[i], &batch});
+    }
+    wake.notify_all();
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+    if (batch.error) std::rethrow_exception(batch.error);
+}
+
+bool WorkStealingPool::popTask(int index, Task &task, bool &stolen) {
+    {
+        Worker &own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            stolen = false;
+            return true;
+        }
+    }
+    for (int i = 1; i < workers.size(); ++i) {
+        Worker &victim = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int index) {
+    Worker &worker = *workers[index];
+    setTraceThreadName("boxWorker" + std::to_string(index));
+    while (true) {
+        Task task;
+        bool stolen;
+        if (popTask(index, task, stolen)) {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                queued--;
+            }
+            double start = getCurrentTime();
+            std::exception_ptr error;
+            try {
+                (*task.func)();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            worker.busyTime = worker.busyTime + (getCurrentTime() - start);
+            worker.taskCount++;
+            if (stolen) worker.stealCount++;
+            //the caller frees the batch once remaining is 0, so it is only touched under its lock
+            std::lock_guard<std::mutex> lock(task.batch->mutex);
+            if (error && !task.batch->error) task.batch->error = error;
+            if (--task.batch->remaining == 0) task.batch->done.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        //queued may be ahead of the queues while run is still pushing, then this only spins briefly
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+std::vector<WorkerStats> WorkStealingPool::getStats() {
+    double elapsed = getCurrentTime() - startTime;
+    std::vector<WorkerStats> stats;
+    for (int i = 0; i < workers.size(); ++i) {
+        Worker &worker = *workers[i];
+        double busyTime = worker.busyTime;
+        stats.emplace_back(WorkerStats{worker.taskCount, worker.stealCount, busyTime,
+                                       elapsed > 0 ? busyTime / elapsed : 0.0});
+    }
+    return stats;
+}
+
+void WorkStealingPool::resetStats() {
+    startTime = getCurrentTime();
+    for (int i = 0; i < workers.size(); ++i) {
+        workers[i]->taskCount = 0;
+        workers[i]->stealCount = 0;
+        workers[i]->busyTime = 0.0;
+    }
+}
@@ -0,0 +1,299 @@
+#include "Workspace.h"
+#include "OcrStruct.h"
+#include "OcrUtils.h"
+
+WorkspaceAllocator::WorkspaceAllocator() {
+    allocations = 0;
+    reuses = 0;
+}
+
+WorkspaceAllocator::~WorkspaceAllocator() {
+    for (auto &it : freeBuffers) {
+        cv::fastFree(it.second);
+    }
+}
+
+uchar *WorkspaceAllocator::takeBuffer(size_t size) const {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        //smallest kept buffer that fits without wasting more than half of it
+        auto it = freeBuffers.lower_bound(size);
+        if (it != freeBuffers.end() && it->first <= size * 2) {
+            uchar *buffer = it->second;
+            heldBytes -= it->first;
+            freeBuffers.erase(it);
+            reuses++;
+            return buffer;
+        }
+    }
+    uchar *buffer = (uchar *) cv::fastMalloc(size);
+    allocations++;
+    std::lock_guard<std::mutex> lock(mutex);
+    capacities[buffer] = size;
+    return buffer;
+}
+
+cv::UMatData *WorkspaceAllocator::allocate(int dims, const int *sizes, int type, void *data0, size_t *step,
+                                           MatAccessFlag flags, cv::UMatUsageFlags usageFlags) const {
+    //same layout as cv::StdMatAllocator
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+    uchar *data = data0 ? (uchar *) data0 : takeBuffer(total);
+    cv::UMatData *u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+}
+
+bool WorkspaceAllocator::allocate(cv::UMatData *u, MatAccessFlag accessFlags,
+                                  cv::UMatUsageFlags usageFlags) const {
+    return u != NULL;
+}
+
+void WorkspaceAllocator::deallocate(cv::UMatData *u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t capacity = capacities[u->origdata];
+        if (heldBytes + capacity <= maxHeldBytes) {
+            freeBuffers.insert(std::make_pair(capacity, u->origdata));
+            heldBytes += capacity;
+        } else {
+            capacities.erase(u->origdata);
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = 0;
+    }
+    delete u;
+}
+
+void WorkspaceAllocator::getStats(long &allocationCount, long &reuseCount, long &heldByteCount) const {
+    allocationCount = allocations;
+    reuseCount = reuses;
+    std::lock_guard<std::mutex> lock(mutex);
+    heldByteCount = heldBytes;
+}
+
+void WorkspaceAllocator::addAllocations(long count) {
+    allocations += count;
+}
+
+static std::atomic<long> nextMeterId(1);
+
+MemoryMeter::MemoryMeter() {
+    heapProbe = false;
+    reset();
+}
+
+void MemoryMeter::reset() {
+    id = nextMeterId++;
+    liveBytes = 0;
+    peakBytes = 0;
+    largestMat = 0;
+    for (int i = 0; i < NETS; ++i) {
+        heapGrowth[i] = 0;
+    }
+}
+
+long MemoryMeter::getId() {
+    return id;
+}
+
+static void storeMax(std::atomic<long> &target, long value) {
+    long current = target.load();
+    while (value > current && !target.compare_exchange_weak(current, value)) {}
+}
+
+void MemoryMeter::add(long bytes) {
+    storeMax(peakBytes, liveBytes += bytes);
+}
+
+void MemoryMeter::sub(long bytes) {
+    liveBytes -= bytes;
+}
+
+void MemoryMeter::addMat(long bytes) {
+    add(bytes);
+    storeMax(largestMat, bytes);
+}
+
+void MemoryMeter::startStage() {
+    peakBytes = liveBytes.load();
+}
+
+long MemoryMeter::getPeak() {
+    return peakBytes;
+}
+
+long MemoryMeter::getLargestMat() {
+    return largestMat;
+}
+
+void MemoryMeter::setHeapProbe(bool enabled) {
+    heapProbe = enabled;
+}
+
+bool MemoryMeter::isHeapProbe() {
+    return heapProbe.load(std::memory_order_relaxed);
+}
+
+void MemoryMeter::addHeapGrowth(Net net, long bytes) {
+    heapGrowth[net] += bytes;
+}
+
+long MemoryMeter::getHeapGrowth(Net net) {
+    return heapGrowth[net];
+}
+
+void MemoryMeter::markHeapStart() {
+    heapStart = isHeapProbe() ? getHeapInUse() : 0;
+}
+
+long MemoryMeter::getHeapSinceStart() {
+    return isHeapProbe() ? getHeapInUse() - heapStart : 0;
+}
+
+Workspace::MeteredAllocator::MeteredAllocator(WorkspaceAllocator *allocator)
+        : meter(nullptr), allocator(allocator) {}
+
+cv::UMatData *Workspace::MeteredAllocator::allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                                                    MatAccessFlag flags, cv::UMatUsageFlags usageFlags) const {
+    cv::UMatData *u = allocator->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    u->currAllocator = u->prevAllocator = this;
+    MemoryMeter *current = meter.load();
+    if (current != nullptr && !(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        //tagged with the call, a Mat outliving it must not be subtracted from the next one
+        u->userdata = (void *) (intptr_t) current->getId();
+        current->addMat((long) u->size);
+    }
+    return u;
+}
+
+bool Workspace::MeteredAllocator::allocate(cv::UMatData *u, MatAccessFlag accessFlags,
+                                           cv::UMatUsageFlags usageFlags) const {
+    return u != NULL;
+}
+
+void Workspace::MeteredAllocator::deallocate(cv::UMatData *u) const {
+    if (!u) return;
+    MemoryMeter *current = meter.load();
+    if (current != nullptr && u->userdata != nullptr && (intptr_t) u->userdata == current->getId()) {
+        current->sub((long) u->size);
+    }
+    u->userdata = nullptr;
+    allocator->deallocate(u);
+}
+
+Workspace::Workspace(WorkspaceAllocator *allocator) : allocator(allocator), meteredAllocator(allocator) {
+    for (int i = 0; i < FLOAT_SLOTS; ++i) {
+        capacities[i] = 0;
+    }
+    meteredAllocator.meter = &ownMeter;
+}
+
+cv::Mat Workspace::newMat() {
+    cv::Mat mat;
+    mat.allocator = &meteredAllocator;
+    return mat;
+}
+
+cv::MatAllocator *Workspace::getAllocator() {
+    return &meteredAllocator;
+}
+
+std::vector<float> &Workspace::getFloats(FloatSlot slot) {
+    //growth of the previous use shows up here, the buffers are kept for the whole call
+    meterFloats();
+    return floats[slot];
+}
+
+void Workspace::meterFloats() {
+    long bytes = 0;
+    for (int i = 0; i < FLOAT_SLOTS; ++i) {
+        bytes += (long) (floats[i].capacity() * sizeof(float));
+    }
+    if (bytes != floatBytes) meteredAllocator.meter.load()->add(bytes - floatBytes);
+    floatBytes = bytes;
+}
+
+MemoryMeter *Workspace::getMeter() {
+    return meteredAllocator.meter;
+}
+
+void Workspace::attachMeter(MemoryMeter *meter) {
+    floatBytes = 0;
+    meteredAllocator.meter = meter;
+    meterFloats();
+}
+
+void Workspace::detachMeter() {
+    meterFloats();
+    meteredAllocator.meter.load()->sub(floatBytes);
+    floatBytes = 0;
+    meteredAllocator.meter = &ownMeter;
+}
+
+void Workspace::countGrowth() {
+    long grown = 0;
+    for (int i = 0; i < FLOAT_SLOTS; ++i) {
+        if (floats[i].capacity() != capacities[i]) {
+            capacities[i] = floats[i].capacity();
+            grown++;
+        }
+    }
+    if (grown > 0) allocator->addAllocations(grown);
+}
+
+WorkspacePool::WorkspacePool() {}
+
+WorkspacePool::~WorkspacePool() {}
+
+Workspace *WorkspacePool::acquire(MemoryMeter *meter) {
+    Workspace *workspace;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeWorkspaces.empty()) {
+            workspace = freeWorkspaces.back();
+            freeWorkspaces.pop_back();
+        } else {
+            workspaces.emplace_back(new Workspace(&allocator));
+            allocator.addAllocations(1);
+            workspace = workspaces.back().get();
+        }
+    }
+    if (meter == nullptr) {
+        meter = workspace->getMeter();
+        meter->reset();
+    }
+    workspace->attachMeter(meter);
+    return workspace;
+}
+
+void WorkspacePool::release(Workspace *workspace) {
+    if (workspace == nullptr) return;
+    workspace->countGrowth();
+    workspace->detachMeter();
+    std::lock_guard<std::mutex> lock(mutex);
+    freeWorkspaces.emplace_back(workspace);
+}
+
+void WorkspaceReleaser::operator()(Workspace *workspace) const {
+    if (pool != nullptr) pool->release(workspace);
+}
+
+void WorkspacePool::getStats(long &allocations, long &reuses, long &heldBytes) {
+    allocator.getStats(allocations, reuses, heldBytes);
+}
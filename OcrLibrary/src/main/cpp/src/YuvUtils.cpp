@@ -0,0 +1,80 @@
+#include "YuvUtils.h"
+#include <algorithm>
+
+//BT.601 video range in 20 bit fixed point, same coefficients as cv::COLOR_YUV2BGR_NV21
+static const int yuvShift = 20;
+static const int cY = 1220542;
+static const int cUB = 2116026;
+static const int cUG = -409993;
+static const int cVG = -852492;
+static const int cVR = 1673527;
+
+static inline uchar clampByte(int value) {
+    return (uchar) (std::min)((std::max)(value, 0), 255);
+}
+
+YuvPlanes getNv21Planes(const uint8_t *data, int width, int height) {
+    const uint8_t *vu = data + width * height;
+    return YuvPlanes{data, vu + 1, vu, width, height, width, width, 2};
+}
+
+bool checkYuvPlanes(const YuvPlanes &yuv, int64_t ySize, int64_t uSize, int64_t vSize) {
+    if (yuv.width <= 0 || yuv.height <= 0 || yuv.uvPixelStride <= 0) return false;
+    int uvCols = (yuv.width + 1) / 2, uvRows = (yuv.height + 1) / 2;
+    int64_t uvRowSize = (int64_t) (uvCols - 1) * yuv.uvPixelStride + 1;
+    if (yuv.yRowStride < yuv.width || yuv.uvRowStride < uvRowSize) return false;
+    int64_t yNeeded = (int64_t) (yuv.height - 1) * yuv.yRowStride + yuv.width;
+    int64_t uvNeeded = (int64_t) (uvRows - 1) * yuv.uvRowStride + uvRowSize;
+    return ySize >= yNeeded && uSize >= uvNeeded && vSize >= uvNeeded;
+}
+
+bool isValidYuvRotation(int rotation) {
+    return rotation == 0 || rotation == 90 || rotation == 180 || rotation == 270;
+}
+
+void yuvToBgrMat(const YuvPlanes &yuv, cv::Rect crop, int rotation, cv::Mat &dst) {
+    cv::Rect frameRect(0, 0, yuv.width, yuv.height);
+    if (crop.width <= 0 || crop.height <= 0) crop = frameRect;
+    crop &= frameRect;
+    CV_Assert(crop.width > 0 && crop.height > 0 && isValidYuvRotation(rotation));
+
+    bool swapSides = rotation == 90 || rotation == 270;
+    int outCols = swapSides ? crop.height : crop.width;
+    int outRows = swapSides ? crop.width : crop.height;
+    dst.create(outRows, outCols, CV_8UC3);
+
+    //source pixel of output (0, row) and the source step per output column
+    int left = crop.x, top = crop.y;
+    int right = crop.x + crop.width - 1, bottom = crop.y + crop.height - 1;
+    cv::parallel_for_(cv::Range(0, outRows), [&](const cv::Range &range) {
+        for (int row = range.start; row < range.end; ++row) {
+            int sx, sy, dx, dy;
+            switch (rotation) {
+                case 90:
+                    sx = left + row, sy = bottom, dx = 0, dy = -1;
+                    break;
+                case 180:
+                    sx = right, sy = bottom - row, dx = -1, dy = 0;
+                    break;
+                case 270:
+                    sx = right - row, sy = top, dx = 0, dy = 1;
+                    break;
+                default:
+                    sx = left, sy = top + row, dx = 1, dy = 0;
+                    break;
+            }
+            uchar *out = dst.ptr<uchar>(row);
+            for (int col = 0; col < outCols; ++col, sx += dx, sy += dy) {
+                int y = yuv.y[sy * yuv.yRowStride + sx];
+                int uvOffset = (sy >> 1) * yuv.uvRowStride + (sx >> 1) * yuv.uvPixelStride;
+                int u = yuv.u[uvOffset] - 128;
+                int v = yuv.v[uvOffset] - 128;
+                int c = (std::max)(y - 16, 0) * cY + (1 << (yuvShift - 1));
+                out[0] = clampByte((c + cUB * u) >> yuvShift);
+                out[1] = clampByte((c + cUG * u + cVG * v) >> yuvShift);
+                out[2] = clampByte((c + cVR * v) >> yuvShift);
+                out += 3;
+            }
+        }
+    });
+}
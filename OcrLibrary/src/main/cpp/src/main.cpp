@@ -2,52 +2,221 @@
 #include "BitmapUtils.h"
 #include "OcrLite.h"
 #include "OcrUtils.h"
+#include "OcrStream.h"
+#include "OcrAsyncTask.h"
+#include "OcrListener.h"
+#include "YuvUtils.h"
+#include "OcrResultBinary.h"
+#include "Trace.h"
+#include <map>
+#include <mutex>
+#include <condition_variable>
 
-static OcrLite *ocrLite;
+//Native state of one Kotlin OcrEngine, its address is kept in OcrEngine.nativeHandle
+//detect may be called from many threads at once, every call keeps its own OcrFrame
+struct OcrEngineHandle {
+    OcrLite ocrLite;
+    //declared after ocrLite, so the stream is stopped first
+    OcrStreamSlot ocrStream{&ocrLite};
+    std::mutex asyncMutex;
+    //shared, so a detectAsyncGet in flight keeps its task alive after the entry is removed
+    std::map<jlong, std::shared_ptr<OcrAsyncTask>> asyncTasks;
+    jlong asyncTaskId = 0;
+    //detectAsyncGet calls still using asyncMutex, destroy waits for them
+    int asyncGets = 0;
+    std::condition_variable asyncGetsDone;
+};
+
+static jfieldID nativeHandleField;
 
 JNIEXPORT jint JNI_OnLoad(JavaVM *vm, void *reserved) {
-    ocrLite = new OcrLite();
+    JNIEnv *env;
+    if (vm->GetEnv((void **) &env, JNI_VERSION_1_4) != JNI_OK) return JNI_ERR;
+    jclass clazz = env->FindClass("com/benjaminwan/ocrlibrary/OcrEngine");
+    if (clazz == NULL) return JNI_ERR;
+    nativeHandleField = env->GetFieldID(clazz, "nativeHandle", "J");
+    env->DeleteLocalRef(clazz);
+    if (!OcrResultUtils::initJniIds(env)) return JNI_ERR;
     return JNI_VERSION_1_4;
 }
 
 JNIEXPORT void JNI_OnUnload(JavaVM *vm, void *reserved) {
     LOGI("Goodbye OcrLite!");
-    delete ocrLite;
+}
+
+OcrEngineHandle *getEngine(JNIEnv *env, jobject thiz) {
+    return (OcrEngineHandle *) env->GetLongField(thiz, nativeHandleField);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_create(JNIEnv *env, jobject thiz) {
+    return (jlong) new OcrEngineHandle();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_destroy(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    env->SetLongField(thiz, nativeHandleField, (jlong) 0);
+    std::map<jlong, std::shared_ptr<OcrAsyncTask>> asyncTasks;
+    {
+        std::unique_lock<std::mutex> lock(engine->asyncMutex);
+        asyncTasks.swap(engine->asyncTasks);
+        for (auto &it : asyncTasks) it.second->cancel();
+        //an in-flight get holds its own task reference and takes the lock once more to erase it
+        engine->asyncGetsDone.wait(lock, [engine] { return engine->asyncGets == 0; });
+    }
+    //the task destructor cancels and waits for the run, which still uses engine->ocrLite
+    asyncTasks.clear();
+    delete engine;
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_benjaminwan_ocrlibrary_OcrEngine_init(JNIEnv *env, jobject thiz, jobject assetManager,
-                                               jint numThread, jstring detName, jstring clsName,
-                                               jstring recName, jstring keysName) {
+                                               jint numThread, jint boxWorkers, jstring detName,
+                                               jstring clsName, jstring recName, jstring keysName) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return JNI_FALSE;
     std::string modelDetName = jstringTostring(env, detName);
     std::string modelClsName = jstringTostring(env, clsName);
     std::string modelRecName = jstringTostring(env, recName);
     std::string modelKeysName = jstringTostring(env, keysName);
-    ocrLite->init(env, assetManager, numThread, modelDetName, modelClsName, modelRecName, modelKeysName);
-    //ocrLite->initLogger(false);
+    AAssetManager *mgr = AAssetManager_fromJava(env, assetManager);
+    if (mgr == NULL) {
+        LOGE(" %s", "AAssetManager==NULL");
+        return JNI_FALSE;
+    }
+    engine->ocrLite.init(mgr, numThread, boxWorkers, modelDetName, modelClsName, modelRecName,
+                         modelKeysName);
+    //engine->ocrLite.initLogger(false);
     return JNI_TRUE;
 }
 
-cv::Mat makePadding(cv::Mat &src, const int padding) {
-    if (padding <= 0) return src;
-    cv::Scalar paddingScalar = {255, 255, 255};
-    cv::Mat paddingSrc;
-    cv::copyMakeBorder(src, paddingSrc, padding, padding, padding, padding, cv::BORDER_ISOLATED,
-                       paddingScalar);
-    return paddingSrc;
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_setMaxRecWidth(JNIEnv *env, jobject thiz, jint width) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrLite.setMaxRecWidth(width);
 }
 
-extern "C"
-JNIEXPORT jobject JNICALL
-Java_com_benjaminwan_ocrlibrary_OcrEngine_detect(JNIEnv *env, jobject thiz, jobject input, jobject output,
-                                                 jint padding, jint maxSideLen, jfloat boxScoreThresh, jfloat boxThresh,
-                                                 jfloat unClipRatio, jboolean doAngle, jboolean mostAngle) {
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_setRecCacheSize(JNIEnv *env, jobject thiz, jint size) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrLite.setRecCacheSize(size);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_setRecWidthQuantum(JNIEnv *env, jobject thiz, jint quantum) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrLite.setRecWidthQuantum(quantum);
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_getRecShapeStats(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    int stats[2];
+    engine->ocrLite.getRecShapeStats(stats[0], stats[1]);
+    jintArray jStats = env->NewIntArray(2);
+    env->SetIntArrayRegion(jStats, 0, 2, (jint *) stats);
+    return jStats;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_resetRecShapeStats(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrLite.resetRecShapeStats();
+}
+
+extern "C" JNIEXPORT jdoubleArray JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_getBoxWorkerStats(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    std::vector<WorkerStats> stats = engine->ocrLite.getBoxWorkerStats();
+    std::vector<double> values;
+    for (auto &worker : stats) {
+        values.emplace_back((double) worker.tasks);
+        values.emplace_back((double) worker.steals);
+        values.emplace_back(worker.busyTime);
+        values.emplace_back(worker.utilization);
+    }
+    jdoubleArray jStats = env->NewDoubleArray(values.size());
+    env->SetDoubleArrayRegion(jStats, 0, values.size(), values.data());
+    return jStats;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_resetBoxWorkerStats(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrLite.resetBoxWorkerStats();
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_getWorkspaceStats(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    long allocations, reuses, heldBytes;
+    engine->ocrLite.getWorkspaceStats(allocations, reuses, heldBytes);
+    jlong values[3] = {allocations, reuses, heldBytes};
+    jlongArray jStats = env->NewLongArray(3);
+    env->SetLongArrayRegion(jStats, 0, 3, values);
+    return jStats;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_setMemoryProbe(JNIEnv *env, jobject thiz, jboolean enabled) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrLite.setMemoryProbe(enabled);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_startProfiling(JNIEnv *env, jobject thiz, jstring dir, jint runs) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return JNI_FALSE;
+    std::string prefix = jstringTostring(env, dir);
+    if (!prefix.empty() && prefix.back() != '/') prefix += '/';
+    return engine->ocrLite.startProfiling(prefix, runs) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_getProfileSummary(JNIEnv *env, jobject thiz, jint topK) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return env->NewStringUTF("");
+    return env->NewStringUTF(engine->ocrLite.getProfileSummary(topK).c_str());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_startTrace(JNIEnv *env, jobject thiz) {
+    startTrace();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_stopTrace(JNIEnv *env, jobject thiz) {
+    stopTrace();
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_getTrace(JNIEnv *env, jobject thiz) {
+    return env->NewStringUTF(getChromeTrace().c_str());
+}
+
+//src: BGR input, padding is only added to the det tensor; boxImg: RGBA image to draw the boxes into in place,
+//empty to draw on a BGR copy
+OcrFrame getOcrFrame(JNIEnv *env, cv::Mat &src, cv::Mat &boxImg, jint padding, jint maxSideLen,
+                     jfloat boxScoreThresh, jfloat boxThresh, jfloat unClipRatio,
+                     jboolean doAngle, jboolean mostAngle,
+                     jstring allowedChars, jstring textPattern, jboolean luhnCheck,
+                     jdouble budget, bool drawBoxImg) {
     Logger("padding(%d),maxSideLen(%d),boxScoreThresh(%f),boxThresh(%f),unClipRatio(%f),doAngle(%d),mostAngle(%d)",
            padding, maxSideLen, boxScoreThresh, boxThresh, unClipRatio, doAngle, mostAngle);
-    cv::Mat imgRGBA, imgBGR, imgOut;
-    bitmapToMat(env, input, imgRGBA);
-    cv::cvtColor(imgRGBA, imgBGR, cv::COLOR_RGBA2BGR);
-    int originMaxSide = (std::max)(imgBGR.cols, imgBGR.rows);
+    std::string charset = jstringTostring(env, allowedChars);
+    std::string pattern = jstringTostring(env, textPattern);
+    int originMaxSide = (std::max)(src.cols, src.rows);
     int resize;
     if (maxSideLen <= 0 || maxSideLen > originMaxSide) {
         resize = originMaxSide;
@@ -55,22 +224,370 @@ Java_com_benjaminwan_ocrlibrary_OcrEngine_detect(JNIEnv *env, jobject thiz, jobj
         resize = maxSideLen;
     }
     resize += 2*padding;
-    cv::Rect paddingRect(padding, padding, imgBGR.cols, imgBGR.rows);
-    cv::Mat paddingSrc = makePadding(imgBGR, padding);
+    cv::Rect originRect(0, 0, src.cols, src.rows);
     //按比例缩小图像，减少文字分割时间
-    ScaleParam s = getScaleParam(paddingSrc, resize);//例：按长或宽缩放 src.cols=不缩放，src.cols/2=长度缩小一半
-    OcrResult ocrResult = ocrLite->detect(paddingSrc, paddingRect, s, boxScoreThresh, boxThresh,
-                                          unClipRatio, doAngle, mostAngle);
+    ScaleParam s = getScaleParam(src, padding, resize);//例：按长或宽缩放 src.cols=不缩放，src.cols/2=长度缩小一半
+    OcrFrame frame{0, src, originRect, s, boxScoreThresh, boxThresh, unClipRatio,
+                   (bool) doAngle, (bool) mostAngle, charset, pattern, (bool) luhnCheck, nullptr, drawBoxImg,
+                   budget};
+    if (drawBoxImg) frame.boxImg = boxImg;
+    return frame;
+}
+
+OcrFrame getOcrFrame(JNIEnv *env, jobject input, jint padding, jint maxSideLen,
+                     jfloat boxScoreThresh, jfloat boxThresh, jfloat unClipRatio,
+                     jboolean doAngle, jboolean mostAngle,
+                     jstring allowedChars, jstring textPattern, jboolean luhnCheck,
+                     jdouble budget, bool drawBoxImg, const cv::Mat &boxPixels = cv::Mat()) {
+    padding = (std::max)(padding, 0);
+    cv::Mat imgRGBA = boxPixels, src;
+    if (drawBoxImg) {
+        //boxes are drawn straight into an RGBA copy of the input, no BGR copy and no conversion back.
+        //With the output pixels locked that copy is the output itself: same size and type, so kept
+        bitmapToMat(env, input, imgRGBA);
+        rgbaToBgrMat(imgRGBA, src);
+    } else {
+        bitmapToBgrMat(env, input, src);
+    }
+    return getOcrFrame(env, src, imgRGBA, padding, maxSideLen, boxScoreThresh, boxThresh, unClipRatio,
+                       doAngle, mostAngle, allowedChars, textPattern, luhnCheck, budget, drawBoxImg);
+}
+
+//output locked for in-place drawing when it is another bitmap of the input size
+cv::Size getBoxPixelsSize(JNIEnv *env, jobject input, jobject output) {
+    if (output == NULL || env->IsSameObject(input, output)) return cv::Size();
+    return getBitmapSize(env, input);
+}
+
+//copies boxImg into output, returns the bitmap for the result: output, or null without boxImg.
+//Nothing to copy when boxImg was drawn into boxPixels, the locked pixels of output
+jobject copyBoxImg(JNIEnv *env, OcrResult &ocrResult, jobject output, const cv::Mat &boxPixels = cv::Mat()) {
+    if (output == NULL || ocrResult.boxImg.empty()) return NULL;
+    if (!boxPixels.empty() && ocrResult.boxImg.data == boxPixels.data) return output;
+    //drawn on a BGR copy of the input when there was no RGBA image to draw into
+    if (ocrResult.boxImg.channels() == 3) cv::cvtColor(ocrResult.boxImg, ocrResult.boxImg, cv::COLOR_BGR2RGBA);
+    matToBitmap(env, ocrResult.boxImg, output);
+    return output;
+}
+
+//output may be null, boxImg is then left out of the result
+jobject getOcrResult(JNIEnv *env, OcrResult &ocrResult, jobject output, const cv::Mat &boxPixels = cv::Mat()) {
+    jobject boxImg = copyBoxImg(env, ocrResult, output, boxPixels);
+    return OcrResultUtils(env, ocrResult, boxImg).getJObject();
+}
+
+//a failed ort run or allocation becomes a RuntimeException in Kotlin instead of aborting the process
+void throwRuntimeException(JNIEnv *env, const std::exception &e) {
+    //an exception of a progressive listener is already pending and is the one kept
+    if (env->ExceptionCheck()) return;
+    jclass je = env->FindClass("java/lang/RuntimeException");
+    env->ThrowNew(je, e.what());
+}
+
+//false with a pending RuntimeException when detect failed
+bool detectOrThrow(JNIEnv *env, OcrEngineHandle *engine, OcrFrame &frame, OcrResult &ocrResult) {
+    try {
+        ocrResult = engine->ocrLite.detect(frame);
+        return true;
+    } catch (std::exception &e) {
+        throwRuntimeException(env, e);
+        return false;
+    }
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detect(JNIEnv *env, jobject thiz, jobject input, jobject output,
+                                                 jint padding, jint maxSideLen, jfloat boxScoreThresh, jfloat boxThresh,
+                                                 jfloat unClipRatio, jboolean doAngle, jboolean mostAngle,
+                                                 jstring allowedChars, jstring textPattern,
+                                                 jboolean luhnCheck, jdouble budget) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    LockedBitmap boxPixels(env, output, getBoxPixelsSize(env, input, output));
+    OcrFrame frame = getOcrFrame(env, input, padding, maxSideLen, boxScoreThresh, boxThresh,
+                                 unClipRatio, doAngle, mostAngle, allowedChars, textPattern, luhnCheck,
+                                 budget, output != NULL, boxPixels.mat);
+    OcrResult ocrResult;
+    if (!detectOrThrow(env, engine, frame, ocrResult)) return NULL;
+    return getOcrResult(env, ocrResult, output, boxPixels.mat);
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detectFlat(JNIEnv *env, jobject thiz, jobject input, jobject output,
+                                                     jint padding, jint maxSideLen, jfloat boxScoreThresh,
+                                                     jfloat boxThresh, jfloat unClipRatio, jboolean doAngle,
+                                                     jboolean mostAngle, jstring allowedChars, jstring textPattern,
+                                                     jboolean luhnCheck, jdouble budget) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    LockedBitmap boxPixels(env, output, getBoxPixelsSize(env, input, output));
+    OcrFrame frame = getOcrFrame(env, input, padding, maxSideLen, boxScoreThresh, boxThresh,
+                                 unClipRatio, doAngle, mostAngle, allowedChars, textPattern, luhnCheck,
+                                 budget, output != NULL, boxPixels.mat);
+    OcrResult ocrResult;
+    if (!detectOrThrow(env, engine, frame, ocrResult)) return NULL;
+    jobject boxImg = copyBoxImg(env, ocrResult, output, boxPixels.mat);
+    return OcrResultUtils(env).getFlatResult(ocrResult, boxImg);
+}
 
-    cv::cvtColor(ocrResult.boxImg, imgOut, cv::COLOR_BGR2RGBA);
-    matToBitmap(env, imgOut, output);
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detectBinary(JNIEnv *env, jobject thiz, jobject input, jobject buffer,
+                                                       jint padding, jint maxSideLen, jfloat boxScoreThresh,
+                                                       jfloat boxThresh, jfloat unClipRatio, jboolean doAngle,
+                                                       jboolean mostAngle, jstring allowedChars, jstring textPattern,
+                                                       jboolean luhnCheck, jdouble budget) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return 0;
+    uint8_t *data = (uint8_t *) env->GetDirectBufferAddress(buffer);
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (data == NULL || capacity < 0) {
+        jclass je = env->FindClass("java/lang/IllegalArgumentException");
+        env->ThrowNew(je, "detectBinary needs a direct ByteBuffer");
+        return 0;
+    }
+    OcrFrame frame = getOcrFrame(env, input, padding, maxSideLen, boxScoreThresh, boxThresh,
+                                 unClipRatio, doAngle, mostAngle, allowedChars, textPattern, luhnCheck,
+                                 budget, false);
+    OcrResult ocrResult;
+    if (!detectOrThrow(env, engine, frame, ocrResult)) return 0;
+    size_t written = writeBinaryResult(ocrResult, data, capacity);
+    //too small: minus the size needed, so the caller can grow the buffer and detect again
+    if (written == 0) return -(jint) getBinaryResultSize(ocrResult);
+    return (jint) written;
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detectYuv(JNIEnv *env, jobject thiz, jobject yPlane, jobject uPlane,
+                                                    jobject vPlane, jint width, jint height, jint yRowStride,
+                                                    jint uvRowStride, jint uvPixelStride, jint cropLeft,
+                                                    jint cropTop, jint cropWidth, jint cropHeight, jint rotation,
+                                                    jobject output, jint padding, jint maxSideLen,
+                                                    jfloat boxScoreThresh, jfloat boxThresh, jfloat unClipRatio,
+                                                    jboolean doAngle, jboolean mostAngle, jstring allowedChars,
+                                                    jstring textPattern, jboolean luhnCheck, jdouble budget) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    YuvPlanes yuv{(const uint8_t *) env->GetDirectBufferAddress(yPlane),
+                  (const uint8_t *) env->GetDirectBufferAddress(uPlane),
+                  (const uint8_t *) env->GetDirectBufferAddress(vPlane),
+                  width, height, yRowStride, uvRowStride, uvPixelStride};
+    cv::Rect crop = cv::Rect(cropLeft, cropTop, cropWidth, cropHeight) & cv::Rect(0, 0, width, height);
+    if (yuv.y == NULL || yuv.u == NULL || yuv.v == NULL || !isValidYuvRotation(rotation) ||
+        (cropWidth > 0 && cropHeight > 0 && crop.area() <= 0)) {
+        jclass je = env->FindClass("java/lang/IllegalArgumentException");
+        env->ThrowNew(je, "detectYuv needs direct buffers, rotation 0/90/180/270 and a crop inside the frame");
+        return NULL;
+    }
+    //the conversion reads the planes unchecked, so they must hold the whole frame with these strides
+    if (!checkYuvPlanes(yuv, env->GetDirectBufferCapacity(yPlane), env->GetDirectBufferCapacity(uPlane),
+                        env->GetDirectBufferCapacity(vPlane))) {
+        jclass je = env->FindClass("java/lang/IllegalArgumentException");
+        env->ThrowNew(je, "detectYuv planes are smaller than width, height and strides need");
+        return NULL;
+    }
+    padding = (std::max)(padding, 0);
+    cv::Mat src;
+    yuvToBgrMat(yuv, crop, rotation, src);
+    //the boxes are drawn into output itself, filled with one conversion instead of a BGR copy converted back
+    LockedBitmap boxPixels(env, output, src.size());
+    if (!boxPixels.mat.empty()) cv::cvtColor(src, boxPixels.mat, cv::COLOR_BGR2RGBA);
+    OcrFrame frame = getOcrFrame(env, src, boxPixels.mat, padding, maxSideLen, boxScoreThresh, boxThresh,
+                                 unClipRatio, doAngle, mostAngle, allowedChars, textPattern, luhnCheck,
+                                 budget, output != NULL);
+    OcrResult ocrResult;
+    if (!detectOrThrow(env, engine, frame, ocrResult)) return NULL;
+    return getOcrResult(env, ocrResult, output, boxPixels.mat);
+}
+
+//Forwards progressive results to a Kotlin OcrListener, only valid on the thread of env
+class JniOcrListener : public OcrListener {
+public:
+    JniOcrListener(JNIEnv *env, jobject listener) : env(env), listener(listener) {
+        jclass clazz = env->GetObjectClass(listener);
+        onTextBoxesMethod = env->GetMethodID(clazz, "onTextBoxes", "(Ljava/util/ArrayList;)V");
+        onTextBlockMethod = env->GetMethodID(clazz, "onTextBlock",
+                                             "(ILcom/benjaminwan/ocrlibrary/TextBlock;)V");
+        env->DeleteLocalRef(clazz);
+    }
+
+    void onTextBoxes(std::vector<TextBox> &textBoxes) override {
+        //a pending Java exception is rethrown when detectProgressive returns, no more calls until then
+        if (env->ExceptionCheck()) return;
+        jobject jTextBoxes = OcrResultUtils(env).getTextBoxes(textBoxes);
+        env->CallVoidMethod(listener, onTextBoxesMethod, jTextBoxes);
+        env->DeleteLocalRef(jTextBoxes);
+    }
+
+    void onTextBlock(int index, TextBlock &textBlock) override {
+        if (env->ExceptionCheck()) return;
+        jobject jTextBlock = OcrResultUtils(env).getTextBlock(textBlock);
+        env->CallVoidMethod(listener, onTextBlockMethod, (jint) index, jTextBlock);
+        env->DeleteLocalRef(jTextBlock);
+    }
+
+private:
+    JNIEnv *env;
+    jobject listener;
+    jmethodID onTextBoxesMethod;
+    jmethodID onTextBlockMethod;
+};
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detectProgressive(JNIEnv *env, jobject thiz, jobject input, jobject output,
+                                                            jint padding, jint maxSideLen, jfloat boxScoreThresh,
+                                                            jfloat boxThresh, jfloat unClipRatio, jboolean doAngle,
+                                                            jboolean mostAngle, jstring allowedChars,
+                                                            jstring textPattern, jboolean luhnCheck,
+                                                            jdouble budget, jboolean largestFirst,
+                                                            jobject listener) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    LockedBitmap boxPixels(env, output, getBoxPixelsSize(env, input, output));
+    OcrFrame frame = getOcrFrame(env, input, padding, maxSideLen, boxScoreThresh, boxThresh,
+                                 unClipRatio, doAngle, mostAngle, allowedChars, textPattern, luhnCheck,
+                                 budget, output != NULL, boxPixels.mat);
+    JniOcrListener ocrListener(env, listener);
+    frame.listener = &ocrListener;
+    frame.largestFirst = largestFirst;
+    OcrResult ocrResult;
+    if (!detectOrThrow(env, engine, frame, ocrResult)) return NULL;
+    return getOcrResult(env, ocrResult, output, boxPixels.mat);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detectAsync(JNIEnv *env, jobject thiz, jobject input,
+                                                      jint padding, jint maxSideLen, jfloat boxScoreThresh, jfloat boxThresh,
+                                                      jfloat unClipRatio, jboolean doAngle, jboolean mostAngle,
+                                                      jstring allowedChars, jstring textPattern,
+                                                      jboolean luhnCheck, jdouble budget, jint timeout,
+                                                      jboolean drawBoxImg) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return -1;
+    OcrFrame frame = getOcrFrame(env, input, padding, maxSideLen, boxScoreThresh, boxThresh,
+                                 unClipRatio, doAngle, mostAngle, allowedChars, textPattern, luhnCheck,
+                                 budget, drawBoxImg);
+    auto task = std::make_shared<OcrAsyncTask>(&engine->ocrLite, std::move(frame), timeout);
+    std::lock_guard<std::mutex> lock(engine->asyncMutex);
+    jlong handle = ++engine->asyncTaskId;
+    engine->asyncTasks[handle] = task;
+    return handle;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detectAsyncCancel(JNIEnv *env, jobject thiz, jlong handle) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    std::lock_guard<std::mutex> lock(engine->asyncMutex);
+    auto it = engine->asyncTasks.find(handle);
+    if (it != engine->asyncTasks.end()) it->second->cancel();
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_detectAsyncGet(JNIEnv *env, jobject thiz, jlong handle,
+                                                         jobject output) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    std::shared_ptr<OcrAsyncTask> task;
+    {
+        std::lock_guard<std::mutex> lock(engine->asyncMutex);
+        auto it = engine->asyncTasks.find(handle);
+        if (it == engine->asyncTasks.end()) return NULL;
+        task = it->second;
+        engine->asyncGets++;
+    }
+    OcrResult ocrResult;
+    bool success = false;
+    try {
+        success = task->get(ocrResult);
+    } catch (std::exception &e) {
+        throwRuntimeException(env, e);
+    }
+    {
+        std::lock_guard<std::mutex> lock(engine->asyncMutex);
+        engine->asyncTasks.erase(handle);
+        if (--engine->asyncGets == 0) engine->asyncGetsDone.notify_all();
+    }
+    if (!success) return NULL;
+    return getOcrResult(env, ocrResult, output);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_streamStart(JNIEnv *env, jobject thiz, jint queueSize) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrStream.start(queueSize);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_streamPush(JNIEnv *env, jobject thiz, jobject input,
+                                                     jint padding, jint maxSideLen, jfloat boxScoreThresh, jfloat boxThresh,
+                                                     jfloat unClipRatio, jboolean doAngle, jboolean mostAngle,
+                                                     jstring allowedChars, jstring textPattern,
+                                                     jboolean luhnCheck, jdouble budget, jboolean drawBoxImg) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return -1;
+    //held for the whole call, a concurrent streamStop only closes it
+    std::shared_ptr<OcrStream> stream = engine->ocrStream.get();
+    if (!stream) return -1;
+    OcrFrame frame = getOcrFrame(env, input, padding, maxSideLen, boxScoreThresh, boxThresh,
+                                 unClipRatio, doAngle, mostAngle, allowedChars, textPattern, luhnCheck,
+                                 budget, drawBoxImg);
+    return (jlong) stream->push(std::move(frame));
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_streamPop(JNIEnv *env, jobject thiz, jobject output) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    std::shared_ptr<OcrStream> stream = engine->ocrStream.get();
+    if (!stream) return NULL;
+    long frameId;
+    OcrResult ocrResult;
+    if (!stream->pop(frameId, ocrResult)) return NULL;
+    Logger("streamPop frame(%ld)", frameId);
+    return getOcrResult(env, ocrResult, output);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_streamFinish(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    std::shared_ptr<OcrStream> stream = engine->ocrStream.get();
+    if (stream) stream->finish();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_streamStop(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return;
+    engine->ocrStream.stop();
+}
 
-    return OcrResultUtils(env, ocrResult, output).getJObject();
+extern "C" JNIEXPORT jdoubleArray JNICALL
+Java_com_benjaminwan_ocrlibrary_OcrEngine_streamStats(JNIEnv *env, jobject thiz) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return NULL;
+    OcrStreamStats stats{};
+    std::shared_ptr<OcrStream> stream = engine->ocrStream.get();
+    if (stream) stats = stream->getStats();
+    double values[7] = {stats.detectOccupancy, stats.recognizeOccupancy, stats.inputQueueDepth,
+                        stats.detectedQueueDepth, stats.outputQueueDepth, (double) stats.frames,
+                        stats.framesPerSecond};
+    jdoubleArray jStats = env->NewDoubleArray(7);
+    env->SetDoubleArrayRegion(jStats, 0, 7, values);
+    return jStats;
 }
 
 extern "C" JNIEXPORT jdouble JNICALL
 Java_com_benjaminwan_ocrlibrary_OcrEngine_benchmark(JNIEnv *env, jobject thiz, jobject input,
                                                     jint loop) {
+    OcrEngineHandle *engine = getEngine(env, thiz);
+    if (engine == NULL) return 0.0;
     int padding = 50;
     int paddingRect= 0;
     float boxScoreThresh = 0.6;
@@ -80,28 +597,31 @@ Java_com_benjaminwan_ocrlibrary_OcrEngine_benchmark(JNIEnv *env, jobject thiz, j
     bool mostAngle = true;
     LOGI("padding(%d),paddingRect(%d),boxScoreThresh(%f),boxThresh(%f),unClipRatio(%f),doAngle(%d),mostAngle(%d)",
          padding, paddingRect, boxScoreThresh, boxThresh, unClipRatio, doAngle, mostAngle);
-    cv::Mat imgRGBA, imgBGR, imgOut;
-    bitmapToMat(env, input, imgRGBA);
-    cv::cvtColor(imgRGBA, imgBGR, cv::COLOR_RGBA2BGR);
-    cv::Rect originRect(padding, padding, imgBGR.cols, imgBGR.rows);
-    cv::Mat src = makePadding(imgBGR, padding);
+    cv::Mat src;
+    bitmapToBgrMat(env, input, src);
+    cv::Rect originRect(0, 0, src.cols, src.rows);
     //按比例缩小图像，减少文字分割时间
-    ScaleParam s = getScaleParam(src, src.cols);//例：按长或宽缩放 src.cols=不缩放，src.cols/2=长度缩小一半
+    ScaleParam s = getScaleParam(src, padding, src.cols + 2 * padding);//例：按长或宽缩放 src.cols=不缩放，src.cols/2=长度缩小一半
 
-    LOGI("=====warmup=====");
-    OcrResult result = ocrLite->detect(src, originRect, s, boxScoreThresh, boxThresh,
-                                       unClipRatio, doAngle, mostAngle);
-    LOGI("dbNetTime(%f) detectTime(%f)\n", result.dbNetTime, result.detectTime);
     double dbTime = 0.0f;
     double detectTime = 0.0f;
     int loopCount = loop;
-    for (int i = 0; i < loopCount; ++i) {
-        LOGI("=====loop:%d=====", i + 1);
-        OcrResult ocrResult = ocrLite->detect(src, originRect, s, boxScoreThresh, boxThresh,
-                                              unClipRatio, doAngle, mostAngle);
-        LOGI("dbNetTime(%f) detectTime(%f)\n", ocrResult.dbNetTime, ocrResult.detectTime);
-        dbTime += ocrResult.dbNetTime;
-        detectTime += ocrResult.detectTime;
+    try {
+        LOGI("=====warmup=====");
+        OcrResult result = engine->ocrLite.detect(src, originRect, s, boxScoreThresh, boxThresh,
+                                                  unClipRatio, doAngle, mostAngle, "", "", false);
+        LOGI("dbNetTime(%f) detectTime(%f)\n", result.dbNetTime, result.detectTime);
+        for (int i = 0; i < loopCount; ++i) {
+            LOGI("=====loop:%d=====", i + 1);
+            OcrResult ocrResult = engine->ocrLite.detect(src, originRect, s, boxScoreThresh, boxThresh,
+                                                         unClipRatio, doAngle, mostAngle, "", "", false);
+            LOGI("dbNetTime(%f) detectTime(%f)\n", ocrResult.dbNetTime, ocrResult.detectTime);
+            dbTime += ocrResult.dbNetTime;
+            detectTime += ocrResult.detectTime;
+        }
+    } catch (std::exception &e) {
+        throwRuntimeException(env, e);
+        return 0.0;
     }
     LOGI("=====result=====\n");
     double averageTime = detectTime / loopCount;
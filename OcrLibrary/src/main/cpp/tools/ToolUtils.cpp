@@ -0,0 +1,179 @@
+#include "ToolUtils.h"
+#include <dirent.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <opencv2/imgcodecs.hpp>
+#include "OcrResultBinary.h"
+#include "OcrUtils.h"
+#include "YuvUtils.h"
+
+bool parseOcrToolArg(int argc, char **argv, int &i, OcrToolArgs &args) {
+    std::string arg = argv[i];
+    if (arg == "--no-angle") {
+        args.doAngle = false;
+        args.mostAngle = false;
+        return true;
+    }
+    if (i + 1 >= argc) return false;
+    const char *value = argv[i + 1];
+    if (arg == "--models") args.models = value;
+    else if (arg == "--det") args.det = value;
+    else if (arg == "--cls") args.cls = value;
+    else if (arg == "--rec") args.rec = value;
+    else if (arg == "--keys") args.keys = value;
+    else if (arg == "--padding") args.padding = (std::max)(atoi(value), 0);
+    else if (arg == "--max-side-len") args.maxSideLen = atoi(value);
+    else if (arg == "--box-score-thresh") args.boxScoreThresh = (float) atof(value);
+    else if (arg == "--box-thresh") args.boxThresh = (float) atof(value);
+    else if (arg == "--unclip-ratio") args.unClipRatio = (float) atof(value);
+    else if (arg == "--threads") args.threads = atoi(value);
+    else if (arg == "--box-workers") args.boxWorkers = atoi(value);
+    else if (arg == "--yuv-size") {
+        cv::Size &size = args.yuvSize;
+        if (sscanf(value, "%dx%d", &size.width, &size.height) != 2 || size.width <= 0 || size.height <= 0) {
+            return false;
+        }
+    } else return false;
+    i++;
+    return true;
+}
+
+void initOcrTool(OcrLite &ocrLite, const OcrToolArgs &args) {
+    ocrLite.init(nullptr, args.threads, args.boxWorkers, args.models + "/" + args.det,
+                 args.models + "/" + args.cls, args.models + "/" + args.rec, args.models + "/" + args.keys);
+}
+
+OcrFrame getOcrToolFrame(cv::Mat &src, const OcrToolArgs &args) {
+    cv::Rect originRect(0, 0, src.cols, src.rows);
+    int originMaxSide = (std::max)(src.cols, src.rows);
+    int resize = args.maxSideLen <= 0 || args.maxSideLen > originMaxSide ? originMaxSide : args.maxSideLen;
+    ScaleParam scale = getScaleParam(src, args.padding, resize + 2 * args.padding);
+    return OcrFrame{0, src, originRect, scale, args.boxScoreThresh, args.boxThresh, args.unClipRatio,
+                    args.doAngle, args.mostAngle, "", "", false, nullptr, false};
+}
+
+OcrResult runOcrTool(OcrLite &ocrLite, cv::Mat &src, const OcrToolArgs &args) {
+    OcrFrame frame = getOcrToolFrame(src, args);
+    return ocrLite.detect(frame);
+}
+
+static std::string getExtension(const std::string &name) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos) return "";
+    std::string ext = name.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext;
+}
+
+static bool isYuvFile(const std::string &name) {
+    std::string ext = getExtension(name);
+    return ext == "nv21" || ext == "yuv";
+}
+
+static bool isImageFile(const std::string &name) {
+    std::string ext = getExtension(name);
+    return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp" || ext == "webp" || isYuvFile(name);
+}
+
+std::vector<std::string> listImages(const std::string &dir) {
+    std::vector<std::string> files;
+    DIR *dp = opendir(dir.c_str());
+    if (dp == NULL) return files;
+    while (dirent *entry = readdir(dp)) {
+        if (isImageFile(entry->d_name)) files.push_back(dir + "/" + entry->d_name);
+    }
+    closedir(dp);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+cv::Mat readToolImage(const std::string &file, cv::Size yuvSize) {
+    if (!isYuvFile(file)) return cv::imread(file, cv::IMREAD_COLOR);
+    cv::Mat dst;
+    if (yuvSize.width <= 0 || yuvSize.height <= 0) return dst;
+    std::ifstream in(file, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    int64_t ySize = (int64_t) yuvSize.width * yuvSize.height;
+    int64_t vuSize = (int64_t) data.size() - ySize;
+    YuvPlanes yuv = getNv21Planes(data.data(), yuvSize.width, yuvSize.height);
+    if (vuSize <= 0 || !checkYuvPlanes(yuv, ySize, vuSize - 1, vuSize)) return dst;
+    yuvToBgrMat(yuv, cv::Rect(), 0, dst);
+    return dst;
+}
+
+double percentile(std::vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    int rank = (int) std::ceil(p / 100.0 * sorted.size());
+    return sorted[(std::min)((std::max)(rank, 1), (int) sorted.size()) - 1];
+}
+
+std::string jsonEscape(const std::string &str) {
+    std::string out;
+    for (char c : str) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char) c < 0x20) continue;
+        out += c;
+    }
+    return out;
+}
+
+//4 points as written by writeBinaryResult, missing ones as 0
+static bool isSameBoxPoint(const std::vector<cv::Point> &boxPoint, const int32_t *binary) {
+    for (int i = 0; i < 4; ++i) {
+        cv::Point point = i < boxPoint.size() ? boxPoint[i] : cv::Point();
+        if (point.x != binary[i * 2] || point.y != binary[i * 2 + 1]) return false;
+    }
+    return true;
+}
+
+static bool isSameBlock(const TextBlock &textBlock, const BinaryTextBlock &block) {
+    if (!isSameBoxPoint(textBlock.boxPoint, block.boxPoint) || textBlock.boxScore != block.boxScore ||
+        textBlock.angleIndex != block.angleIndex || textBlock.angleScore != block.angleScore ||
+        textBlock.angleTime != block.angleTime || textBlock.crnnTime != block.crnnTime ||
+        textBlock.blockTime != block.blockTime || textBlock.text != std::string(block.text, block.textLength) ||
+        textBlock.charScores.size() != block.charCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < block.charCount; ++i) {
+        if (textBlock.charScores[i] != block.getCharScore(i)) return false;
+    }
+    return true;
+}
+
+std::string compareBinaryResult(const OcrResult &result, const uint8_t *data, size_t size) {
+    BinaryResultReader reader(data, size);
+    if (!reader.isValid()) return "invalid header";
+    if (reader.getSize() != getBinaryResultSize(result)) return "size";
+    if (reader.isPartial() != result.partial || reader.getCacheHits() != result.cacheHits ||
+        reader.getCacheMisses() != result.cacheMisses || reader.getDbNetTime() != result.dbNetTime ||
+        reader.getDetectTime() != result.detectTime) {
+        return "header fields";
+    }
+    if (reader.getBlockCount() != result.textBlocks.size()) return "block count";
+    if (reader.getSkippedCount() != result.skippedBoxes.size()) return "skipped box count";
+    BinaryTextBlock block;
+    for (int i = 0; i < result.textBlocks.size(); ++i) {
+        if (!reader.nextBlock(block) || !isSameBlock(result.textBlocks[i], block)) {
+            return "block " + std::to_string(i);
+        }
+    }
+    BinaryTextBox textBox;
+    for (int i = 0; i < result.skippedBoxes.size(); ++i) {
+        if (!reader.nextSkippedBox(textBox) || !isSameBoxPoint(result.skippedBoxes[i].boxPoint, textBox.boxPoint) ||
+            result.skippedBoxes[i].score != textBox.score) {
+            return "skipped box " + std::to_string(i);
+        }
+    }
+    return "";
+}
+
+std::string checkBinaryRoundTrip(const OcrResult &result, std::vector<uint8_t> &buffer) {
+    buffer.resize(getBinaryResultSize(result));
+    size_t written = writeBinaryResult(result, buffer.data(), buffer.size());
+    if (written != buffer.size()) return "written size";
+    return compareBinaryResult(result, buffer.data(), written);
+}
@@ -0,0 +1,69 @@
+#ifndef __OCR_TOOL_UTILS_H__
+#define __OCR_TOOL_UTILS_H__
+
+//Shared by the host tools: model and detect options, image listing, one detect call
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "OcrLite.h"
+
+//model names are inside models; detect defaults are the ones of the Android demo
+struct OcrToolArgs {
+    std::string models;
+    std::string det = "ch_PP-OCRv3_det_infer.onnx";
+    std::string cls = "ch_ppocr_mobile_v2.0_cls_infer.onnx";
+    std::string rec = "ch_PP-OCRv3_rec_infer.onnx";
+    std::string keys = "ppocr_keys_v1.txt";
+    int padding = 50;
+    int maxSideLen = 1024;
+    float boxScoreThresh = 0.5f;
+    float boxThresh = 0.3f;
+    float unClipRatio = 1.6f;
+    bool doAngle = true;
+    bool mostAngle = true;
+    int threads = 4;
+    int boxWorkers = 1;
+    cv::Size yuvSize;//of the raw .nv21/.yuv frames
+};
+
+#define OCR_TOOL_USAGE \
+    "  --det/--cls/--rec/--keys <file>  model names inside --models\n" \
+    "  --padding <n>            default 50\n" \
+    "  --max-side-len <n>       default 1024, 0 keeps the original size\n" \
+    "  --box-score-thresh <f>   default 0.5\n" \
+    "  --box-thresh <f>         default 0.3\n" \
+    "  --unclip-ratio <f>       default 1.6\n" \
+    "  --no-angle               skip the angle net\n" \
+    "  --threads <n>            ort threads per net, default 4\n" \
+    "  --box-workers <n>        default 1\n" \
+    "  --yuv-size <w>x<h>       size of the .nv21/.yuv files (raw NV21 frames) among the images\n"
+
+//true when arg is one of OCR_TOOL_USAGE, i is moved past its value
+bool parseOcrToolArg(int argc, char **argv, int &i, OcrToolArgs &args);
+
+void initOcrTool(OcrLite &ocrLite, const OcrToolArgs &args);
+
+//frame scaled with getScaleParam the same way as the JNI detect entry points
+OcrFrame getOcrToolFrame(cv::Mat &src, const OcrToolArgs &args);
+
+OcrResult runOcrTool(OcrLite &ocrLite, cv::Mat &src, const OcrToolArgs &args);
+
+//image files of dir, sorted by name
+std::vector<std::string> listImages(const std::string &dir);
+
+//BGR image of a file: decoded by opencv, or converted from NV21 like JNI detectYuv for .nv21/.yuv,
+//empty when unreadable, or for a raw frame without yuvSize or smaller than it
+cv::Mat readToolImage(const std::string &file, cv::Size yuvSize);
+
+//nearest rank
+double percentile(std::vector<double> &sorted, double p);
+
+std::string jsonEscape(const std::string &str);
+
+//first difference between result and its binary form read back with BinaryResultReader, empty when equal
+std::string compareBinaryResult(const OcrResult &result, const uint8_t *data, size_t size);
+
+//writes result with writeBinaryResult into buffer (resized) and reads it back, empty when equal
+std::string checkBinaryRoundTrip(const OcrResult &result, std::vector<uint8_t> &buffer);
+
+#endif //__OCR_TOOL_UTILS_H__
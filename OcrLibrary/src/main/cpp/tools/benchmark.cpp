@@ -0,0 +1,326 @@
+//Host benchmark: runs OcrLite over a directory of images (or raw NV21 frames) and reports per-stage
+//latency percentiles
+#include <sys/resource.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "OcrLite.h"
+#include "OcrResultBinary.h"
+#include "OcrUtils.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include "ToolUtils.h"
+
+struct BenchmarkArgs : OcrToolArgs {
+    std::string images;
+    std::string json;
+    std::string trace;
+    std::string binary;
+    int loops = 1;
+    int warmup = 1;
+    bool heapProbe = false;
+    bool perfCounters = false;
+    int profileRuns = 0;
+    int profileTop = 10;
+    std::string profileDir = ".";
+};
+
+//StageCounters field summed over all calls
+struct CounterSamples {
+    const char *name;
+    PerfSample sum;
+};
+
+//reads the results of --binary back, false when a record does not parse or the counts differ
+static bool readBinaryResults(const std::string &path, long resultCount, long blockCount) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    long results = 0, blocks = 0;
+    for (size_t offset = 0; offset < data.size(); ++results) {
+        BinaryResultReader reader(data.data() + offset, data.size() - offset);
+        if (!reader.isValid()) return false;
+        BinaryTextBlock block;
+        while (reader.nextBlock(block)) blocks++;
+        BinaryTextBox textBox;
+        while (reader.nextSkippedBox(textBox)) {}
+        if (!reader.isValid()) return false;
+        offset += reader.getSize();
+    }
+    return results == resultCount && blocks == blockCount;
+}
+
+//samples of one stage in ms
+struct StageSamples {
+    const char *name;
+    std::vector<double> values;
+};
+
+//bytes of one MemoryStats field over all calls
+struct MemorySamples {
+    const char *name;
+    long max;
+    long total;
+};
+
+static void printUsage(const char *name) {
+    fprintf(stderr,
+            "usage: %s --models <dir> --images <dir> [options]\n"
+            OCR_TOOL_USAGE
+            "  --loops <n>              measured passes over the images, default 1\n"
+            "  --warmup <n>             unmeasured images before the first pass, default 1\n"
+            "  --json <file>            also write the report as json\n"
+            "  --trace <file>           write a chrome trace of the measured passes\n"
+            "  --binary <file>          write the measured results back to back in the OcrResultBinary\n"
+            "                           format, check each one and the file read back\n"
+            "  --heap-probe             heap growth of each net during its ort runs\n"
+            "  --perf-counters          cycles, instructions, cache and branch misses of each stage\n"
+            "                           (perf_event_open, see kernel.perf_event_paranoid)\n"
+            "  --profile-runs <n>       after the measured passes, ort profile n more images and\n"
+            "                           print the top operators of each net\n"
+            "  --profile-top <n>        operators listed per net, default 10\n"
+            "  --profile-dir <dir>      where the ort profile files go, default .\n", name);
+}
+
+static bool parseArgs(int argc, char **argv, BenchmarkArgs &args) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (parseOcrToolArg(argc, argv, i, args)) continue;
+        if (arg == "--heap-probe") {
+            args.heapProbe = true;
+            continue;
+        }
+        if (arg == "--perf-counters") {
+            args.perfCounters = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if (arg == "--images") args.images = value;
+        else if (arg == "--json") args.json = value;
+        else if (arg == "--trace") args.trace = value;
+        else if (arg == "--binary") args.binary = value;
+        else if (arg == "--loops") args.loops = (std::max)(atoi(value), 1);
+        else if (arg == "--warmup") args.warmup = (std::max)(atoi(value), 0);
+        else if (arg == "--profile-runs") args.profileRuns = (std::max)(atoi(value), 0);
+        else if (arg == "--profile-top") args.profileTop = (std::max)(atoi(value), 1);
+        else if (arg == "--profile-dir") args.profileDir = value;
+        else return false;
+    }
+    return !args.models.empty() && !args.images.empty();
+}
+
+int main(int argc, char **argv) {
+    BenchmarkArgs args;
+    if (!parseArgs(argc, argv, args)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::vector<std::string> files = listImages(args.images);
+    if (files.empty()) {
+        fprintf(stderr, "no images in %s\n", args.images.c_str());
+        return 1;
+    }
+
+    OcrLite ocrLite;
+    initOcrTool(ocrLite, args);
+    ocrLite.setMemoryProbe(args.heapProbe);
+
+    for (int i = 0; i < args.warmup; ++i) {
+        cv::Mat src = readToolImage(files[i % files.size()], args.yuvSize);
+        if (!src.empty()) runOcrTool(ocrLite, src, args);
+    }
+
+    std::vector<StageSamples> stages = {
+            {"decode"}, {"dbPreprocess"}, {"dbInference"}, {"dbPostprocess"},
+            {"crop"}, {"angle"}, {"crnn"}, {"detect"}, {"total"}
+    };
+    std::vector<MemorySamples> memory = {
+            {"detectPeak"}, {"cropPeak"}, {"recognizePeak"}, {"largestMat"},
+            {"dbNetHeapGrowth"}, {"angleNetHeapGrowth"}, {"crnnNetHeapGrowth"}, {"frameHeapGrowth"}
+    };
+    std::vector<CounterSamples> counters = {
+            {"dbPreprocess"}, {"dbInference"}, {"dbPostprocess"}, {"crop"}, {"angle"}, {"crnn"}, {"recognize"}
+    };
+    if (args.perfCounters && !startPerfCounters()) {
+        fprintf(stderr, "perf counters not available, try sysctl kernel.perf_event_paranoid=2\n");
+        args.perfCounters = false;
+    }
+    long imageCount = 0, lineCount = 0;
+    FILE *binaryFile = NULL;
+    std::vector<uint8_t> binaryBuffer;
+    long binaryErrors = 0;
+    if (!args.binary.empty()) {
+        binaryFile = fopen(args.binary.c_str(), "wb");
+        if (binaryFile == NULL) {
+            fprintf(stderr, "open %s failed\n", args.binary.c_str());
+            return 1;
+        }
+    }
+    if (!args.trace.empty()) {
+        setTraceThreadName("main");
+        startTrace();
+    }
+    double benchStart = getCurrentTime();
+    for (int loop = 0; loop < args.loops; ++loop) {
+        for (auto &file : files) {
+            double startTime = getCurrentTime();
+            cv::Mat src = readToolImage(file, args.yuvSize);
+            if (src.empty()) {
+                fprintf(stderr, "skip unreadable %s\n", file.c_str());
+                continue;
+            }
+            double decodeTime = getCurrentTime() - startTime;
+            addTraceSpan("decode", imageCount, startTime, startTime + decodeTime);
+            OcrResult result = runOcrTool(ocrLite, src, args);
+            double totalTime = getCurrentTime() - startTime;
+            const StageTimes &times = result.stageTimes;
+            double values[] = {decodeTime, times.dbPreprocess, times.dbInference, times.dbPostprocess,
+                               times.crop, times.angle, times.crnn, result.detectTime, totalTime};
+            for (int i = 0; i < stages.size(); ++i) {
+                stages[i].values.push_back(values[i]);
+            }
+            const MemoryStats &mem = result.memoryStats;
+            long bytes[] = {mem.detectPeak, mem.cropPeak, mem.recognizePeak, mem.largestMat,
+                            mem.dbNetHeapGrowth, mem.angleNetHeapGrowth, mem.crnnNetHeapGrowth, mem.frameHeapGrowth};
+            for (int i = 0; i < memory.size(); ++i) {
+                memory[i].max = (std::max)(memory[i].max, bytes[i]);
+                memory[i].total += bytes[i];
+            }
+            const StageCounters &stageCounters = result.stageCounters;
+            PerfSample perfSamples[] = {stageCounters.dbPreprocess, stageCounters.dbInference,
+                                        stageCounters.dbPostprocess, stageCounters.crop, stageCounters.angle,
+                                        stageCounters.crnn, stageCounters.recognize};
+            for (int i = 0; i < counters.size(); ++i) {
+                addPerfSample(counters[i].sum, PerfSample{}, perfSamples[i]);
+            }
+            imageCount++;
+            lineCount += result.textBlocks.size();
+            if (binaryFile != NULL) {
+                std::string difference = checkBinaryRoundTrip(result, binaryBuffer);
+                if (!difference.empty()) {
+                    fprintf(stderr, "binary round trip of %s differs: %s\n", file.c_str(), difference.c_str());
+                    binaryErrors++;
+                }
+                fwrite(binaryBuffer.data(), 1, binaryBuffer.size(), binaryFile);
+            }
+        }
+    }
+    double wallTime = getCurrentTime() - benchStart;
+    if (binaryFile != NULL) {
+        fclose(binaryFile);
+        if (!readBinaryResults(args.binary, imageCount, lineCount)) {
+            fprintf(stderr, "%s does not read back as %ld results\n", args.binary.c_str(), imageCount);
+            binaryErrors++;
+        }
+    }
+    if (args.perfCounters) stopPerfCounters();
+    if (!args.trace.empty()) {
+        stopTrace();
+        FILE *file = fopen(args.trace.c_str(), "w");
+        if (file != NULL) {
+            std::string trace = getChromeTrace();
+            fwrite(trace.data(), 1, trace.size(), file);
+            fclose(file);
+        } else {
+            fprintf(stderr, "open %s failed\n", args.trace.c_str());
+        }
+    }
+    //profiled runs are slower, so they come after the measured passes; angle and crnn
+    //run once per box and finish their profiles within the first images
+    if (args.profileRuns > 0) {
+        if (ocrLite.startProfiling(args.profileDir + "/", args.profileRuns)) {
+            for (int i = 0; i < args.profileRuns; ++i) {
+                cv::Mat src = readToolImage(files[i % files.size()], args.yuvSize);
+                if (!src.empty()) runOcrTool(ocrLite, src, args);
+            }
+        } else {
+            fprintf(stderr, "start profiling failed\n");
+        }
+    }
+    double imagesPerSec = wallTime > 0 ? imageCount * 1000.0 / wallTime : 0.0;
+    double linesPerSec = wallTime > 0 ? lineCount * 1000.0 / wallTime : 0.0;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peakRssKb = usage.ru_maxrss;
+
+    printf("images(%ld) lines(%ld) wall(%.1fms) images/s(%.2f) lines/s(%.2f) peakRss(%ldKB)\n",
+           imageCount, lineCount, wallTime, imagesPerSec, linesPerSec, peakRssKb);
+    printf("%-14s %10s %10s %10s %10s\n", "stage(ms)", "mean", "p50", "p95", "p99");
+    for (auto &stage : stages) {
+        std::vector<double> &values = stage.values;
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (double value : values) sum += value;
+        printf("%-14s %10.2f %10.2f %10.2f %10.2f\n", stage.name, values.empty() ? 0.0 : sum / values.size(),
+               percentile(values, 50), percentile(values, 95), percentile(values, 99));
+    }
+    printf("%-18s %10s %10s\n", "memory(KB)", "max", "total");
+    for (auto &samples : memory) {
+        printf("%-18s %10ld %10ld\n", samples.name, samples.max / 1024, samples.total / 1024);
+    }
+    if (args.perfCounters) {
+        //misses per 1000 instructions
+        printf("%-14s %10s %10s %6s %10s %10s\n", "counters", "cycles(M)", "instr(M)", "IPC", "cacheMPKI",
+               "branchMPKI");
+        for (auto &samples : counters) {
+            const PerfSample &sum = samples.sum;
+            double kiloInstructions = sum.instructions / 1000.0;
+            printf("%-14s %10.1f %10.1f %6.2f %10.2f %10.2f\n", samples.name, sum.cycles / 1e6,
+                   sum.instructions / 1e6, sum.cycles > 0 ? (double) sum.instructions / sum.cycles : 0.0,
+                   kiloInstructions > 0 ? sum.cacheMisses / kiloInstructions : 0.0,
+                   kiloInstructions > 0 ? sum.branchMisses / kiloInstructions : 0.0);
+        }
+    }
+    if (!args.binary.empty()) {
+        printf("binary(%s) results(%ld) %s\n", args.binary.c_str(), imageCount,
+               binaryErrors == 0 ? "round trip ok" : "round trip FAILED");
+    }
+    if (args.profileRuns > 0) {
+        printf("%-26s %8s %12s %7s\n", "operator", "calls", "time", "share");
+        printf("%s", ocrLite.getProfileSummary(args.profileTop).c_str());
+    }
+
+    if (!args.json.empty()) {
+        FILE *file = fopen(args.json.c_str(), "w");
+        if (file == NULL) {
+            fprintf(stderr, "open %s failed\n", args.json.c_str());
+            return 1;
+        }
+        fprintf(file, "{\n  \"config\": {\"images\": \"%s\", \"padding\": %d, \"maxSideLen\": %d, "
+                      "\"boxScoreThresh\": %g, \"boxThresh\": %g, \"unClipRatio\": %g, \"doAngle\": %s, "
+                      "\"threads\": %d, \"boxWorkers\": %d, \"loops\": %d, \"warmup\": %d, \"heapProbe\": %s, "
+                      "\"perfCounters\": %s},\n",
+                jsonEscape(args.images).c_str(), args.padding, args.maxSideLen, args.boxScoreThresh,
+                args.boxThresh, args.unClipRatio, args.doAngle ? "true" : "false", args.threads,
+                args.boxWorkers, args.loops, args.warmup, args.heapProbe ? "true" : "false",
+                args.perfCounters ? "true" : "false");
+        fprintf(file, "  \"images\": %ld,\n  \"lines\": %ld,\n  \"wallMs\": %.3f,\n  \"imagesPerSec\": %.3f,\n"
+                      "  \"linesPerSec\": %.3f,\n  \"peakRssKb\": %ld,\n  \"stages\": {\n",
+                imageCount, lineCount, wallTime, imagesPerSec, linesPerSec, peakRssKb);
+        for (int i = 0; i < stages.size(); ++i) {
+            std::vector<double> &values = stages[i].values;
+            fprintf(file, "    \"%s\": {\"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+                    stages[i].name, percentile(values, 50), percentile(values, 95), percentile(values, 99),
+                    values.empty() ? 0.0 : values.back(), i + 1 < stages.size() ? "," : "");
+        }
+        fprintf(file, "  },\n  \"memoryBytes\": {\n");
+        for (int i = 0; i < memory.size(); ++i) {
+            fprintf(file, "    \"%s\": {\"max\": %ld, \"total\": %ld}%s\n", memory[i].name, memory[i].max,
+                    memory[i].total, i + 1 < memory.size() ? "," : "");
+        }
+        fprintf(file, "  },\n  \"counters\": {\n");
+        for (int i = 0; i < counters.size(); ++i) {
+            const PerfSample &sum = counters[i].sum;
+            fprintf(file, "    \"%s\": {\"cycles\": %ld, \"instructions\": %ld, \"cacheMisses\": %ld, "
+                          "\"branchMisses\": %ld}%s\n", counters[i].name, sum.cycles, sum.instructions,
+                    sum.cacheMisses, sum.branchMisses, i + 1 < counters.size() ? "," : "");
+        }
+        fprintf(file, "  }\n}\n");
+        fclose(file);
+    }
+    return binaryErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+//Host stress test of concurrent detect calls on one OcrLite, the way Kotlin threads share one OcrEngine:
+//every caller runs detect, detect with boxImg, OcrAsyncTask and progressive detect over the same images and
+//each result must match a single-threaded reference. Exercises the workspace pool, the box workers, the
+//crnn result cache, the line cost average and the shape stats from many threads at once
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include "OcrLite.h"
+#include "OcrAsyncTask.h"
+#include "OcrListener.h"
+#include "OcrUtils.h"
+#include "ToolUtils.h"
+
+struct StressArgs : OcrToolArgs {
+    int callers = 4;
+    int iterations = 20;
+    int recCacheSize = 64;
+
+    StressArgs() {
+        boxWorkers = 2;
+    }
+};
+
+enum DetectMode {
+    MODE_DETECT,
+    MODE_BOX_IMG,
+    MODE_ASYNC,
+    MODE_PROGRESSIVE,
+    MODE_COUNT
+};
+
+static const char *modeNames[] = {"detect", "boxImg", "async", "progressive"};
+
+static void printUsage(const char *name) {
+    fprintf(stderr,
+            "usage: %s --models <dir> [options]\n"
+            OCR_TOOL_USAGE
+            "                           (here box workers default to 2)\n"
+            "  --callers <n>            threads calling detect at once, default 4\n"
+            "  --iterations <n>         detect calls per thread, default 20\n"
+            "  --rec-cache <n>          crnn result cache size, default 64, 0 disables it\n"
+            "exit code 0 passed, 1 failed, 2 bad arguments\n", name);
+}
+
+static bool parseArgs(int argc, char **argv, StressArgs &args) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (parseOcrToolArg(argc, argv, i, args)) continue;
+        if (i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if (arg == "--callers") args.callers = (std::max)(atoi(value), 1);
+        else if (arg == "--iterations") args.iterations = (std::max)(atoi(value), 1);
+        else if (arg == "--rec-cache") args.recCacheSize = (std::max)(atoi(value), 0);
+        else return false;
+    }
+    return !args.models.empty();
+}
+
+static cv::Mat renderLines(const std::vector<std::string> &lines, bool upsideDown) {
+    cv::Mat img(48 + 56 * (int) lines.size(), 520, CV_8UC3, cv::Scalar::all(255));
+    for (int i = 0; i < lines.size(); ++i) {
+        cv::putText(img, lines[i], cv::Point(16, 64 + 56 * i), cv::FONT_HERSHEY_SIMPLEX, 1.2, cv::Scalar::all(20),
+                    2, cv::LINE_AA);
+    }
+    if (upsideDown) cv::rotate(img, img, cv::ROTATE_180);
+    return img;
+}
+
+//checks the blocks against the boxes announced before, the final result is compared with the reference
+class StressListener : public OcrListener {
+public:
+    std::vector<TextBox> boxes;
+    std::vector<TextBlock> blocks;
+    std::vector<int> indexes;
+
+    void onTextBoxes(std::vector<TextBox> &textBoxes) override {
+        boxes = textBoxes;
+    }
+
+    void onTextBlock(int index, TextBlock &textBlock) override {
+        indexes.push_back(index);
+        blocks.push_back(textBlock);
+    }
+
+    std::string check(const OcrResult &result) {
+        if (indexes.size() != result.textBlocks.size()) return "listener got a different block count";
+        std::vector<char> seen(boxes.size(), 0);
+        for (int i = 0; i < indexes.size(); ++i) {
+            int index = indexes[i];
+            if (index < 0 || index >= boxes.size() || seen[index]) return "bad listener block index";
+            seen[index] = 1;
+            if (blocks[i].boxPoint != boxes[index].boxPoint) return "listener block outside its box";
+            if (blocks[i].text != result.textBlocks[index].text) return "listener text differs from result";
+        }
+        return "";
+    }
+};
+
+static OcrResult runDetect(OcrLite &ocrLite, cv::Mat &img, DetectMode mode, const StressArgs &args,
+                           std::string &error) {
+    OcrFrame frame = getOcrToolFrame(img, args);
+    if (mode == MODE_BOX_IMG) {
+        frame.drawBoxImg = true;
+    } else if (mode == MODE_ASYNC) {
+        OcrAsyncTask task(&ocrLite, std::move(frame), 0);
+        OcrResult result;
+        if (!task.get(result)) error = "async task cancelled";
+        return result;
+    } else if (mode == MODE_PROGRESSIVE) {
+        StressListener listener;
+        frame.listener = &listener;
+        OcrResult result = ocrLite.detect(frame);
+        error = listener.check(result);
+        return result;
+    }
+    OcrResult result = ocrLite.detect(frame);
+    if (mode == MODE_BOX_IMG && result.boxImg.size() != img.size()) error = "no boxImg";
+    return result;
+}
+
+//first difference of what a caller sees: boxes, angles and text of each block
+static std::string compareResult(const OcrResult &result, const OcrResult &reference) {
+    if (result.partial) return "partial result";
+    if (result.textBlocks.size() != reference.textBlocks.size()) {
+        return "block count " + std::to_string(result.textBlocks.size()) + " != " +
+               std::to_string(reference.textBlocks.size());
+    }
+    for (int i = 0; i < result.textBlocks.size(); ++i) {
+        const TextBlock &block = result.textBlocks[i];
+        const TextBlock &expected = reference.textBlocks[i];
+        std::string index = "block " + std::to_string(i) + ": ";
+        if (block.boxPoint != expected.boxPoint) return index + "box differs";
+        if (block.angleIndex != expected.angleIndex) return index + "angle differs";
+        if (block.text != expected.text) return index + "\"" + block.text + "\" != \"" + expected.text + "\"";
+    }
+    return "";
+}
+
+int main(int argc, char **argv) {
+    StressArgs args;
+    if (!parseArgs(argc, argv, args)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    OcrLite ocrLite;
+    initOcrTool(ocrLite, args);
+    ocrLite.setRecCacheSize(args.recCacheSize);
+    std::vector<cv::Mat> images{
+            renderLines({"shared engine 0123", "INVOICE 2024-0117"}, false),
+            renderLines({"Serial No. A7X-552", "Lot 0042", "stress 9876543210"}, false),
+            renderLines({"upside down page", "RapidOcr stress"}, true)};
+
+    //single-threaded reference of every image in every mode, later calls may be served from the cache
+    std::vector<std::vector<OcrResult>> references(images.size());
+    for (int i = 0; i < images.size(); ++i) {
+        for (int mode = 0; mode < MODE_COUNT; ++mode) {
+            std::string error;
+            references[i].push_back(runDetect(ocrLite, images[i], (DetectMode) mode, args, error));
+            if (!error.empty() || references[i].back().textBlocks.empty()) {
+                printf("reference %d %s: %s\n", i, modeNames[mode], error.empty() ? "no text" : error.c_str());
+                return 1;
+            }
+        }
+    }
+
+    std::atomic<long> calls(0), failures(0), exceptions(0);
+    std::mutex printMutex;
+    double startTime = getCurrentTime();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < args.callers; ++t) {
+        threads.emplace_back([&, t] {
+            for (int n = 0; n < args.iterations; ++n) {
+                //neighbouring threads are on different images and modes at the same moment
+                int image = (t + n) % images.size();
+                DetectMode mode = (DetectMode) ((t + n / images.size()) % MODE_COUNT);
+                std::string error;
+                try {
+                    OcrResult result = runDetect(ocrLite, images[image], mode, args, error);
+                    if (error.empty()) error = compareResult(result, references[image][mode]);
+                } catch (std::exception &e) {
+                    exceptions++;
+                    error = std::string("exception: ") + e.what();
+                }
+                calls++;
+                if (error.empty()) continue;
+                failures++;
+                std::lock_guard<std::mutex> lock(printMutex);
+                printf("caller %d call %d image %d %s: %s\n", t, n, image, modeNames[mode], error.c_str());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    double time = getCurrentTime() - startTime;
+
+    int rawShapes, runShapes;
+    ocrLite.getRecShapeStats(rawShapes, runShapes);
+    bool passed = failures == 0 && exceptions == 0 && calls == (long) args.callers * args.iterations;
+    printf("callers(%d) calls(%ld) failures(%ld) exceptions(%ld) recShapes(%d/%d) %.1fms %s\n", args.callers,
+           (long) calls, (long) failures, (long) exceptions, rawShapes, runShapes, time,
+           passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
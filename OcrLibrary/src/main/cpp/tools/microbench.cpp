@@ -0,0 +1,158 @@
+//Microbenchmarks of the pre/post-processing hot spots on synthetic inputs, no models needed
+#include <benchmark/benchmark.h>
+#include <opencv2/imgproc.hpp>
+#include "CrnnNet.h"
+#include "OcrUtils.h"
+
+//same constants as the nets
+static const float dbMean[3] = {0.485f * 255, 0.456f * 255, 0.406f * 255};
+static const float dbNorm[3] = {1.0f / 0.229f / 255.0f, 1.0f / 0.224f / 255.0f, 1.0f / 0.225f / 255.0f};
+static const int crnnHeight = 48;
+static const int crnnClasses = 6625;//ppocr_keys_v1 + blank + space
+
+//BGR noise with dark text-like bars, so resize and crop see real contrast
+static cv::Mat getTestImage(int width, int height) {
+    cv::Mat img(height, width, CV_8UC3);
+    cv::RNG rng(width * 31 + height);
+    rng.fill(img, cv::RNG::UNIFORM, 180, 255);
+    for (int y = 16; y + 24 < height; y += 48) {
+        for (int x = 8; x + 40 < width; x += 56) {
+            cv::rectangle(img, cv::Rect(x, y, rng.uniform(16, 48), 24), cv::Scalar::all(rng.uniform(0, 60)), -1);
+        }
+    }
+    return img;
+}
+
+//probability map like DbNet output: background near 0, text regions near 1
+static cv::Mat getTestPred(int width, int height) {
+    cv::Mat pred(height, width, CV_32FC1);
+    cv::RNG rng(width + height);
+    rng.fill(pred, cv::RNG::UNIFORM, 0.0f, 0.05f);
+    for (int y = 8; y + 16 < height; y += 32) {
+        cv::rectangle(pred, cv::Rect(8, y, width - 16, 16), cv::Scalar::all(0.9), -1);
+    }
+    return pred;
+}
+
+//box of width x 32 around the image center, tilted by 5 degrees
+static std::vector<cv::Point2f> getTestBox(const cv::Size &size, int width) {
+    cv::RotatedRect rect(cv::Point2f(size.width / 2.0f, size.height / 2.0f), cv::Size2f(width, 32.0f), 5.0f);
+    cv::Point2f points[4];
+    rect.points(points);
+    return std::vector<cv::Point2f>(points, points + 4);
+}
+
+static void BM_SubstractMeanNormalize(benchmark::State &state) {
+    int side = state.range(0);
+    cv::Mat src = getTestImage(side, side);
+    std::vector<float> values;
+    for (auto _ : state) {
+        substractMeanNormalize(src, dbMean, dbNorm, values);
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * src.total());
+}
+BENCHMARK(BM_SubstractMeanNormalize)->Arg(320)->Arg(640)->Arg(960)->Arg(1280);
+
+//the DbNet path: resized src into a tensor with a 50px virtual border
+static void BM_SubstractMeanNormalizePadded(benchmark::State &state) {
+    int side = state.range(0);
+    cv::Mat src = getTestImage(side - 100, side - 100);
+    std::vector<float> values;
+    for (auto _ : state) {
+        substractMeanNormalize(src, 50, 50, side, side, dbMean, dbNorm, values);
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * side * side);
+}
+BENCHMARK(BM_SubstractMeanNormalizePadded)->Arg(320)->Arg(640)->Arg(960)->Arg(1280);
+
+static void BM_BoxScoreFast(benchmark::State &state) {
+    cv::Mat pred = getTestPred(960, 960);
+    std::vector<cv::Point2f> box = getTestBox(pred.size(), state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(boxScoreFast(box, pred));
+    }
+}
+BENCHMARK(BM_BoxScoreFast)->Arg(32)->Arg(128)->Arg(512)->Arg(900);
+
+static void BM_UnClip(benchmark::State &state) {
+    std::vector<cv::Point2f> box = getTestBox(cv::Size(960, 960), state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(unClip(box, 1.6f));
+    }
+}
+BENCHMARK(BM_UnClip)->Arg(32)->Arg(128)->Arg(512);
+
+static void BM_GetMinBoxes(benchmark::State &state) {
+    cv::RotatedRect rect(cv::Point2f(480, 480), cv::Size2f(state.range(0), 32), 5.0f);
+    float maxSideLen;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getMinBoxes(rect, maxSideLen));
+    }
+}
+BENCHMARK(BM_GetMinBoxes)->Arg(32)->Arg(512);
+
+static void BM_GetRotateCropImage(benchmark::State &state) {
+    cv::Mat src = getTestImage(1280, 960);
+    std::vector<cv::Point2f> box = getTestBox(src.size(), state.range(0));
+    std::vector<cv::Point> intBox(box.begin(), box.end());
+    for (auto _ : state) {
+        cv::Mat partImg = getRotateCropImage(src, intBox, nullptr);
+        benchmark::DoNotOptimize(partImg.data);
+    }
+}
+BENCHMARK(BM_GetRotateCropImage)->Arg(64)->Arg(256)->Arg(800);
+
+//a crop scaled to the crnn input height
+static void BM_AdjustTargetImg(benchmark::State &state) {
+    int width = state.range(0);
+    cv::Mat src = getTestImage(width, 40);
+    for (auto _ : state) {
+        cv::Mat dst = adjustTargetImg(src, width * crnnHeight / 40, crnnHeight, nullptr);
+        benchmark::DoNotOptimize(dst.data);
+    }
+}
+BENCHMARK(BM_AdjustTargetImg)->Arg(64)->Arg(320)->Arg(1280);
+
+//softmax-like steps x classes, every other step blank, the rest peaked on one char
+static std::vector<float> getTestScores(int steps) {
+    std::vector<float> scores(steps * crnnClasses);
+    cv::RNG rng(steps);
+    for (int i = 0; i < steps; ++i) {
+        float *step = &scores[i * crnnClasses];
+        for (int c = 0; c < crnnClasses; ++c) step[c] = rng.uniform(0.0f, 1e-5f);
+        step[i % 2 == 0 ? 0 : rng.uniform(1, crnnClasses)] = 0.95f;
+    }
+    return scores;
+}
+
+static std::vector<std::string> getTestKeys() {
+    std::vector<std::string> keys{"#"};
+    for (int i = 1; i < crnnClasses; ++i) {
+        int code = 0x4E00 + i;//CJK, 3 bytes in utf-8
+        char utf8[4] = {(char) (0xE0 | (code >> 12)), (char) (0x80 | ((code >> 6) & 0x3F)),
+                        (char) (0x80 | (code & 0x3F)), 0};
+        keys.emplace_back(utf8);
+    }
+    return keys;
+}
+
+//steps = input width / 8
+static void BM_ScoreToTextLine(benchmark::State &state) {
+    int steps = state.range(0);
+    std::vector<float> scores = getTestScores(steps);
+    std::vector<std::string> keys = getTestKeys();
+    std::vector<int> charsetIndexes;
+    if (state.range(1) != 0) {
+        for (int i = 1; i <= 10; ++i) charsetIndexes.push_back(i);//digits only
+    }
+    for (auto _ : state) {
+        TextLine textLine = scoreToTextLine(scores, steps, crnnClasses, keys, charsetIndexes);
+        benchmark::DoNotOptimize(textLine.text.data());
+    }
+    state.SetItemsProcessed(state.iterations() * steps);
+}
+BENCHMARK(BM_ScoreToTextLine)->ArgsProduct({{40, 160, 400}, {0, 1}});
+
+BENCHMARK_MAIN();
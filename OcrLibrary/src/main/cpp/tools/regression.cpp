@@ -0,0 +1,375 @@
+//Host regression suite: runs OcrLite over a versioned dataset, checks the recognized text against the
+//expected text with a character error rate tolerance, the OcrResultBinary round trip of each result
+//and the per-stage latency against a baseline
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include "OcrLite.h"
+#include "OcrUtils.h"
+#include "ToolUtils.h"
+
+#define SYNTHETIC_SPEC "synthetic.txt"
+
+struct RegressionArgs : OcrToolArgs {
+    std::string data;
+    std::string baseline;
+    std::string writeSynthetic;
+    bool updateBaseline = false;
+    float maxCer = 0.1f;
+    float maxSlowdown = 0.2f;
+    float minSlowdownMs = 1.0f;
+    int loops = 5;
+};
+
+//one image of the dataset and the lines expected on it, top to bottom
+struct RegressionCase {
+    std::string name;
+    cv::Mat img;
+    std::vector<std::string> lines;
+};
+
+//stage times summed over every case of one pass
+static const char *stageNames[] = {"dbPreprocess", "dbInference", "dbPostprocess", "crop", "angle", "crnn",
+                                   "detect"};
+static const int stageCount = sizeof(stageNames) / sizeof(stageNames[0]);
+
+static void printUsage(const char *name) {
+    fprintf(stderr,
+            "usage: %s --models <dir> --data <dir> [options]\n"
+            OCR_TOOL_USAGE
+            "  --baseline <file>        per-stage latency to compare with, not checked when left out\n"
+            "  --update-baseline        write the latency of this run to --baseline instead\n"
+            "  --max-cer <f>            character error rate allowed per image, default 0.1\n"
+            "  --max-slowdown <f>       stage latency allowed over the baseline, default 0.2 (+20%%)\n"
+            "  --min-slowdown-ms <f>    smaller slowdowns are noise, default 1.0\n"
+            "  --loops <n>              timed passes over the dataset, the median counts, default 5\n"
+            "  --write-synthetic <dir>  also save the rendered synthetic images\n"
+            "exit code 0 passed, 1 regressed, 2 bad arguments or data\n", name);
+}
+
+static bool parseArgs(int argc, char **argv, RegressionArgs &args) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (parseOcrToolArg(argc, argv, i, args)) continue;
+        if (arg == "--update-baseline") {
+            args.updateBaseline = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if (arg == "--data") args.data = value;
+        else if (arg == "--baseline") args.baseline = value;
+        else if (arg == "--write-synthetic") args.writeSynthetic = value;
+        else if (arg == "--max-cer") args.maxCer = (float) atof(value);
+        else if (arg == "--max-slowdown") args.maxSlowdown = (float) atof(value);
+        else if (arg == "--min-slowdown-ms") args.minSlowdownMs = (float) atof(value);
+        else if (arg == "--loops") args.loops = (std::max)(atoi(value), 1);
+        else return false;
+    }
+    if (args.updateBaseline && args.baseline.empty()) return false;
+    return !args.models.empty() && !args.data.empty();
+}
+
+static std::vector<std::string> split(const std::string &str, char separator) {
+    std::vector<std::string> fields;
+    std::string field;
+    std::istringstream in(str);
+    while (std::getline(in, field, separator)) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+//black Hershey text on white, rotated by angle degrees on a canvas that fits it, then blurred a little
+static cv::Mat renderSynthetic(const std::vector<std::string> &lines, double fontScale, double angle) {
+    const int font = cv::FONT_HERSHEY_SIMPLEX;
+    const int margin = 24;
+    int thickness = (std::max)(1, cvRound(fontScale * 2));
+    int width = 0, lineHeight = 0;
+    for (auto &line : lines) {
+        int baseline = 0;
+        cv::Size size = cv::getTextSize(line, font, fontScale, thickness, &baseline);
+        width = (std::max)(width, size.width);
+        lineHeight = (std::max)(lineHeight, size.height + baseline);
+    }
+    int lineStep = lineHeight * 2;
+    cv::Mat img(margin * 2 + lineStep * (int) lines.size(), width + margin * 2, CV_8UC3, cv::Scalar::all(255));
+    for (int i = 0; i < lines.size(); ++i) {
+        cv::putText(img, lines[i], cv::Point(margin, margin + lineStep * i + lineHeight), font, fontScale,
+                    cv::Scalar::all(20), thickness, cv::LINE_AA);
+    }
+    if (angle != 0.0) {
+        cv::Point2f center(img.cols / 2.0f, img.rows / 2.0f);
+        cv::Mat rotation = cv::getRotationMatrix2D(center, angle, 1.0);
+        cv::Rect2f bounds = cv::RotatedRect(center, img.size(), (float) angle).boundingRect2f();
+        rotation.at<double>(0, 2) += bounds.width / 2.0 - center.x;
+        rotation.at<double>(1, 2) += bounds.height / 2.0 - center.y;
+        cv::Mat rotated;
+        cv::warpAffine(img, rotated, rotation, cv::Size(cvRound(bounds.width), cvRound(bounds.height)),
+                       cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(255));
+        img = rotated;
+    }
+    cv::GaussianBlur(img, img, cv::Size(3, 3), 0);
+    return img;
+}
+
+//synthetic.txt: "# version <n>" first, then name|font scale|angle|line|line...
+static bool loadSynthetic(const std::string &file, int &version, std::vector<RegressionCase> &cases) {
+    std::ifstream in(file);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            sscanf(line.c_str(), "# version %d", &version);
+            continue;
+        }
+        std::vector<std::string> fields = split(line, '|');
+        if (fields.size() < 4) {
+            fprintf(stderr, "bad line in %s: %s\n", file.c_str(), line.c_str());
+            return false;
+        }
+        RegressionCase regressionCase;
+        regressionCase.name = fields[0];
+        regressionCase.lines.assign(fields.begin() + 3, fields.end());
+        regressionCase.img = renderSynthetic(regressionCase.lines, atof(fields[1].c_str()),
+                                             atof(fields[2].c_str()));
+        cases.push_back(regressionCase);
+    }
+    return true;
+}
+
+//images of dir with the expected lines in a .txt of the same name
+static void loadImages(const std::string &dir, cv::Size yuvSize, std::vector<RegressionCase> &cases) {
+    for (auto &file : listImages(dir)) {
+        std::string textFile = file.substr(0, file.rfind('.')) + ".txt";
+        std::ifstream in(textFile);
+        if (!in) {
+            fprintf(stderr, "skip %s without %s\n", file.c_str(), textFile.c_str());
+            continue;
+        }
+        RegressionCase regressionCase;
+        regressionCase.name = file.substr(dir.size() + 1);
+        regressionCase.img = readToolImage(file, yuvSize);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) regressionCase.lines.push_back(line);
+        }
+        if (regressionCase.img.empty()) {
+            fprintf(stderr, "skip unreadable %s\n", file.c_str());
+            continue;
+        }
+        cases.push_back(regressionCase);
+    }
+}
+
+//code points of the text with whitespace left out, the nets do not agree on spaces
+static std::vector<std::string> getChars(const std::string &text) {
+    std::vector<std::string> chars;
+    for (int i = 0; i < text.size();) {
+        unsigned char c = text[i];
+        int len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+        if (!isspace(c)) chars.push_back(text.substr(i, len));
+        i += len;
+    }
+    return chars;
+}
+
+//edit distance over the expected length
+static double getCer(const std::string &expected, const std::string &actual) {
+    std::vector<std::string> a = getChars(expected);
+    std::vector<std::string> b = getChars(actual);
+    if (a.empty()) return b.empty() ? 0.0 : 1.0;
+    std::vector<int> prev(b.size() + 1), cur(b.size() + 1);
+    for (int j = 0; j <= b.size(); ++j) prev[j] = j;
+    for (int i = 1; i <= a.size(); ++i) {
+        cur[0] = i;
+        for (int j = 1; j <= b.size(); ++j) {
+            int substitute = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            cur[j] = (std::min)(substitute, (std::min)(prev[j], cur[j - 1]) + 1);
+        }
+        prev.swap(cur);
+    }
+    return (double) prev[b.size()] / a.size();
+}
+
+//text blocks in reading order: rows by box center, then left to right, rows joined by newlines
+static std::string getReadingText(const std::vector<TextBlock> &blocks) {
+    struct Item {
+        cv::Rect rect;
+        const std::string *text;
+    };
+    std::vector<Item> items;
+    for (auto &block : blocks) {
+        items.push_back({cv::boundingRect(block.boxPoint), &block.text});
+    }
+    std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+        return a.rect.y + a.rect.height / 2 < b.rect.y + b.rect.height / 2;
+    });
+    std::string text;
+    for (int i = 0; i < items.size();) {
+        int rowCenter = items[i].rect.y + items[i].rect.height / 2;
+        int j = i + 1;
+        while (j < items.size() && items[j].rect.y < rowCenter) j++;
+        std::sort(items.begin() + i, items.begin() + j, [](const Item &a, const Item &b) {
+            return a.rect.x < b.rect.x;
+        });
+        if (!text.empty()) text += "\n";
+        for (int k = i; k < j; ++k) {
+            if (k > i) text += " ";
+            text += *items[k].text;
+        }
+        i = j;
+    }
+    return text;
+}
+
+static std::string joinLines(const std::vector<std::string> &lines) {
+    std::string text;
+    for (auto &line : lines) {
+        if (!text.empty()) text += "\n";
+        text += line;
+    }
+    return text;
+}
+
+//baseline file: "version <n>", "cases <n>", then "<stage> <ms per pass>" lines
+static bool readBaseline(const std::string &file, int &version, int &cases, std::vector<double> &stages) {
+    std::ifstream in(file);
+    if (!in) return false;
+    stages.assign(stageCount, -1.0);
+    std::string key;
+    double value;
+    while (in >> key >> value) {
+        if (key == "version") version = (int) value;
+        else if (key == "cases") cases = (int) value;
+        for (int i = 0; i < stageCount; ++i) {
+            if (key == stageNames[i]) stages[i] = value;
+        }
+    }
+    return true;
+}
+
+static bool writeBaseline(const std::string &file, int version, int cases, const std::vector<double> &stages) {
+    FILE *fp = fopen(file.c_str(), "w");
+    if (fp == NULL) return false;
+    fprintf(fp, "version %d\ncases %d\n", version, cases);
+    for (int i = 0; i < stageCount; ++i) {
+        fprintf(fp, "%s %.3f\n", stageNames[i], stages[i]);
+    }
+    fclose(fp);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    RegressionArgs args;
+    if (!parseArgs(argc, argv, args)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    int version = 0;
+    std::vector<RegressionCase> cases;
+    if (!loadSynthetic(args.data + "/" + SYNTHETIC_SPEC, version, cases)) {
+        fprintf(stderr, "no usable %s in %s\n", SYNTHETIC_SPEC, args.data.c_str());
+        return 2;
+    }
+    loadImages(args.data, args.yuvSize, cases);
+    if (cases.empty()) {
+        fprintf(stderr, "no cases in %s\n", args.data.c_str());
+        return 2;
+    }
+    if (!args.writeSynthetic.empty()) {
+        for (auto &regressionCase : cases) {
+            cv::imwrite(args.writeSynthetic + "/" + regressionCase.name + ".png", regressionCase.img);
+        }
+    }
+
+    OcrLite ocrLite;
+    initOcrTool(ocrLite, args);
+
+    //first pass: text and binary result check, also the warmup
+    bool passed = true;
+    std::vector<uint8_t> binaryBuffer;
+    printf("dataset version(%d) cases(%d)\n", version, (int) cases.size());
+    printf("%-24s %6s  %s\n", "case", "cer", "text");
+    for (auto &regressionCase : cases) {
+        OcrResult result = runOcrTool(ocrLite, regressionCase.img, args);
+        std::string text = getReadingText(result.textBlocks);
+        std::string expected = joinLines(regressionCase.lines);
+        double cer = getCer(expected, text);
+        bool ok = cer <= args.maxCer;
+        std::string difference = checkBinaryRoundTrip(result, binaryBuffer);
+        if (!difference.empty()) {
+            printf("%-24s binary round trip differs: %s\n", regressionCase.name.c_str(), difference.c_str());
+            ok = false;
+        }
+        passed = passed && ok;
+        std::string shown = text;
+        std::replace(shown.begin(), shown.end(), '\n', '|');
+        printf("%-24s %6.3f  %s%s\n", regressionCase.name.c_str(), cer, shown.c_str(), ok ? "" : "  << FAIL");
+        if (!ok) {
+            std::replace(expected.begin(), expected.end(), '\n', '|');
+            printf("%-24s %6s  %s\n", "", "expect", expected.c_str());
+        }
+    }
+
+    std::vector<std::vector<double>> samples(stageCount);
+    for (int loop = 0; loop < args.loops; ++loop) {
+        std::vector<double> sums(stageCount, 0.0);
+        for (auto &regressionCase : cases) {
+            OcrResult result = runOcrTool(ocrLite, regressionCase.img, args);
+            const StageTimes &times = result.stageTimes;
+            double values[] = {times.dbPreprocess, times.dbInference, times.dbPostprocess, times.crop,
+                               times.angle, times.crnn, result.detectTime};
+            for (int i = 0; i < stageCount; ++i) sums[i] += values[i];
+        }
+        for (int i = 0; i < stageCount; ++i) samples[i].push_back(sums[i]);
+    }
+    std::vector<double> medians(stageCount);
+    for (int i = 0; i < stageCount; ++i) {
+        std::sort(samples[i].begin(), samples[i].end());
+        medians[i] = percentile(samples[i], 50);
+    }
+
+    if (args.updateBaseline) {
+        if (!writeBaseline(args.baseline, version, (int) cases.size(), medians)) {
+            fprintf(stderr, "write %s failed\n", args.baseline.c_str());
+            return 2;
+        }
+        printf("baseline written to %s\n", args.baseline.c_str());
+    }
+    int baseVersion = -1, baseCases = -1;
+    std::vector<double> baseline(stageCount, -1.0);
+    bool compare = !args.baseline.empty() && !args.updateBaseline;
+    if (compare && !readBaseline(args.baseline, baseVersion, baseCases, baseline)) {
+        fprintf(stderr, "read %s failed\n", args.baseline.c_str());
+        return 2;
+    }
+    if (compare && (baseVersion != version || baseCases != (int) cases.size())) {
+        printf("baseline is of dataset version(%d) cases(%d), rerun with --update-baseline\n",
+               baseVersion, baseCases);
+        passed = false;
+        compare = false;
+    }
+    printf("%-14s %10s %10s %8s\n", "stage(ms/pass)", "median", "baseline", "change");
+    for (int i = 0; i < stageCount; ++i) {
+        if (!compare || baseline[i] < 0) {
+            printf("%-14s %10.2f %10s %8s\n", stageNames[i], medians[i], "-", "-");
+            continue;
+        }
+        double change = baseline[i] > 0 ? (medians[i] - baseline[i]) / baseline[i] : 0.0;
+        bool ok = change <= args.maxSlowdown || medians[i] - baseline[i] <= args.minSlowdownMs;
+        passed = passed && ok;
+        printf("%-14s %10.2f %10.2f %+7.1f%%%s\n", stageNames[i], medians[i], baseline[i], change * 100,
+               ok ? "" : "  << FAIL");
+    }
+    printf("%s\n", passed ? "PASSED" : "REGRESSED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+//Host stress test of OcrStreamSlot: pushers and poppers share one slot while it is started, finished
+//and stopped over and over, the way Kotlin threads drive streamPush/streamPop/streamStart/streamStop
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include "OcrLite.h"
+#include "OcrStream.h"
+#include "OcrUtils.h"
+#include "ToolUtils.h"
+
+struct StressArgs : OcrToolArgs {
+    double seconds = 5.0;
+    int pushers = 2;
+    int poppers = 2;
+    int queueSize = 2;
+};
+
+static void printUsage(const char *name) {
+    fprintf(stderr,
+            "usage: %s --models <dir> [options]\n"
+            OCR_TOOL_USAGE
+            "  --seconds <f>            default 5\n"
+            "  --pushers <n>            threads pushing frames, default 2\n"
+            "  --poppers <n>            threads popping results, default 2\n"
+            "  --queue-size <n>         default 2\n"
+            "exit code 0 passed, 1 failed, 2 bad arguments\n", name);
+}
+
+static bool parseArgs(int argc, char **argv, StressArgs &args) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (parseOcrToolArg(argc, argv, i, args)) continue;
+        if (i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if (arg == "--seconds") args.seconds = atof(value);
+        else if (arg == "--pushers") args.pushers = (std::max)(atoi(value), 1);
+        else if (arg == "--poppers") args.poppers = (std::max)(atoi(value), 1);
+        else if (arg == "--queue-size") args.queueSize = (std::max)(atoi(value), 1);
+        else return false;
+    }
+    return !args.models.empty();
+}
+
+static cv::Mat renderLine(const std::string &line) {
+    cv::Mat img(64, 420, CV_8UC3, cv::Scalar::all(255));
+    cv::putText(img, line, cv::Point(16, 44), cv::FONT_HERSHEY_SIMPLEX, 1.2, cv::Scalar::all(20), 2, cv::LINE_AA);
+    return img;
+}
+
+int main(int argc, char **argv) {
+    StressArgs args;
+    if (!parseArgs(argc, argv, args)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    OcrLite ocrLite;
+    initOcrTool(ocrLite, args);
+    cv::Mat img = renderLine("stream 0123456789");
+
+    OcrStreamSlot slot(&ocrLite);
+    std::atomic<bool> running(true);
+    std::atomic<long> pushed(0), popped(0), bad(0), restarts(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < args.pushers; ++i) {
+        threads.emplace_back([&] {
+            while (running) {
+                std::shared_ptr<OcrStream> stream = slot.get();
+                if (!stream) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (stream->push(getOcrToolFrame(img, args)) >= 0) pushed++;
+            }
+        });
+    }
+    for (int i = 0; i < args.poppers; ++i) {
+        threads.emplace_back([&] {
+            while (running) {
+                std::shared_ptr<OcrStream> stream = slot.get();
+                long frameId;
+                OcrResult result;
+                if (!stream || !stream->pop(frameId, result)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                popped++;
+                //a stop drops frames, it never hands out a broken one
+                if (result.partial || result.textBlocks.empty()) bad++;
+            }
+        });
+    }
+    threads.emplace_back([&] {
+        while (running) {
+            std::shared_ptr<OcrStream> stream = slot.get();
+            if (stream) stream->getStats();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    //restarts with random lifetimes, some streams are finished before they are stopped
+    std::mt19937 random(7);
+    double end = getCurrentTime() + args.seconds * 1000.0;
+    while (getCurrentTime() < end) {
+        slot.start(args.queueSize);
+        std::this_thread::sleep_for(std::chrono::milliseconds(random() % 200));
+        if (random() % 2 == 0) {
+            std::shared_ptr<OcrStream> stream = slot.get();
+            if (stream) stream->finish();
+            std::this_thread::sleep_for(std::chrono::milliseconds(random() % 50));
+        }
+        if (random() % 4 != 0) slot.stop();
+        restarts++;
+    }
+    slot.stop();
+    running = false;
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    bool passed = popped > 0 && bad == 0;
+    printf("restarts(%ld) pushed(%ld) popped(%ld) bad(%ld) %s\n", (long) restarts, (long) pushed, (long) popped,
+           (long) bad, passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
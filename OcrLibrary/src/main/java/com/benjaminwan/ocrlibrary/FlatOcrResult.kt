@@ -0,0 +1,49 @@
+package com.benjaminwan.ocrlibrary
+
+import android.graphics.Bitmap
+
+/**
+ * 紧凑格式的识别结果，所有文本行数据放在少量基本类型数组中，文本行很多时JNI传递开销远小于OcrResult
+ * 第i行: boxPoints[i*8 until i*8+8]为4个点的x,y，times[i*3 until i*3+3]为[angleTime, crnnTime, blockTime]，
+ * charScores[charScoreOffsets[i] until charScoreOffsets[i+1]]为各字符得分
+ * skippedBoxPoints/skippedBoxScores同理，为超出耗时预算未识别的文本框
+ */
+class FlatOcrResult(
+    val dbNetTime: Double,
+    val detectTime: Double,
+    val boxImg: Bitmap?,
+    val boxPoints: IntArray,
+    val boxScores: FloatArray,
+    val angleIndexes: IntArray,
+    val angleScores: FloatArray,
+    val times: DoubleArray,
+    val texts: Array<String>,
+    val charScores: FloatArray,
+    val charScoreOffsets: IntArray,
+    val cacheHits: Int,
+    val cacheMisses: Int,
+    val partial: Boolean,
+    val skippedBoxPoints: IntArray,
+    val skippedBoxScores: FloatArray
+) : OcrOutput() {
+    val size: Int get() = texts.size
+
+    val strRes: String get() = texts.joinToString("") { "$it\n" }
+
+    private fun getBoxPoint(points: IntArray, index: Int): ArrayList<Point> =
+        ArrayList((0 until 4).map { Point(points[index * 8 + it * 2], points[index * 8 + it * 2 + 1]) })
+
+    fun getTextBlock(index: Int) = TextBlock(
+        getBoxPoint(boxPoints, index), boxScores[index],
+        angleIndexes[index], angleScores[index], times[index * 3],
+        texts[index], charScores.copyOfRange(charScoreOffsets[index], charScoreOffsets[index + 1]),
+        times[index * 3 + 1], times[index * 3 + 2]
+    )
+
+    //转为逐对象的OcrResult
+    fun toOcrResult() = OcrResult(
+        dbNetTime, ArrayList((0 until size).map { getTextBlock(it) }), boxImg, detectTime, strRes,
+        cacheHits, cacheMisses, partial,
+        ArrayList(skippedBoxScores.indices.map { TextBox(getBoxPoint(skippedBoxPoints, it), skippedBoxScores[it]) })
+    )
+}
@@ -3,16 +3,29 @@ package com.benjaminwan.ocrlibrary
 import android.content.Context
 import android.content.res.AssetManager
 import android.graphics.Bitmap
+import android.graphics.ImageFormat
+import android.graphics.Rect
+import android.media.Image
+import java.nio.ByteBuffer
 
-class OcrEngine(context: Context) {
+/**
+ * boxWorkers>1时，检测后各文本框的裁剪、方向分类与识别在boxWorkers个线程上并行(工作窃取)，
+ * 方向分类与识别模型的线程数相应减为numThread/boxWorkers，总线程数不超过numThread
+ * 模型推理失败时各detect方法抛出RuntimeException，取消或超时停止的不算失败，返回部分结果
+ */
+class OcrEngine(context: Context, boxWorkers: Int = 1) {
     companion object {
         const val numThread: Int = 4
     }
 
+    //native引擎句柄，每个OcrEngine独立持有一套模型与配置，同一实例可多线程并发detect
+    private var nativeHandle: Long = 0
+
     init {
         System.loadLibrary("RapidOcr")
+        nativeHandle = create()
         val ret = init(
-            context.assets, numThread,
+            context.assets, numThread, boxWorkers,
             "ch_PP-OCRv3_det_infer.onnx",
             "ch_ppocr_mobile_v2.0_cls_infer.onnx",
             "ch_PP-OCRv3_rec_infer.onnx",
@@ -27,26 +40,277 @@ class OcrEngine(context: Context) {
     var unClipRatio: Float = 1.6f
     var doAngle: Boolean = true
     var mostAngle: Boolean = true
+    //识别时只允许输出的字符，空表示不限制
+    var allowedChars: String = ""
+    //文本行需完整匹配的正则(子集)，非空时使用约束束搜索解码，无匹配则回退为贪心解码
+    var textPattern: String = ""
+    //约束解码结果末尾为15位数字时是否需通过Luhn校验(IMEI)，17位的IMEISV没有校验位，不校验
+    var luhnCheck: Boolean = false
+    //每次识别的耗时预算(ms)，检测后按框得分*面积优先、依历史单行耗时估算，只识别预算内的文本行，
+    //其余文本框放在结果的skippedBoxes中，<=0表示不限制
+    var latencyBudget: Double = 0.0
+
+    //识别模型最大输入宽度(缩放到高48后)，超长文本行按此宽度重叠分块识别后拼接，<=0表示不分块
+    var maxRecWidth: Int = 1600
+        set(value) {
+            field = value
+            setMaxRecWidth(value)
+        }
+
+    //识别输入宽度向上取整到此值的倍数(右侧补白)，减少输入尺寸种类以复用ORT内存，0表示不取整
+    var recWidthQuantum: Int = 0
+        set(value) {
+            field = value
+            setRecWidthQuantum(value)
+        }
 
-    fun detect(input: Bitmap, output: Bitmap, maxSideLen: Int) =
+    //文本行识别结果缓存条数(LRU，按缩放后文本行图像指纹)，0表示不缓存
+    var recCacheSize: Int = 0
+        set(value) {
+            field = value
+            setRecCacheSize(value)
+        }
+
+    //output为null时不绘制文本框，结果中boxImg为null
+    fun detect(input: Bitmap, output: Bitmap?, maxSideLen: Int) =
         detect(
             input, output, padding, maxSideLen,
             boxScoreThresh, boxThresh,
-            unClipRatio, doAngle, mostAngle
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget
+        )
+
+    //同detect，结果为紧凑格式FlatOcrResult，适合文本行很多的图片
+    fun detectFlat(input: Bitmap, output: Bitmap?, maxSideLen: Int) =
+        detectFlat(
+            input, output, padding, maxSideLen,
+            boxScoreThresh, boxThresh,
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget
+        )
+
+    /**
+     * 同detect，结果以紧凑二进制格式(小端，布局见native OcrResultBinary.h)写入direct ByteBuffer起始处，不创建Java对象
+     * 返回写入的字节数；buffer容量不足时返回所需字节数的相反数，此时buffer内容无效
+     */
+    fun detectBinary(input: Bitmap, buffer: ByteBuffer, maxSideLen: Int): Int =
+        detectBinary(
+            input, buffer, padding, maxSideLen,
+            boxScoreThresh, boxThresh,
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget
+        )
+
+    /**
+     * 直接识别相机YUV_420_888帧，YUV转BGR、裁剪与旋转在native一次完成，无需先转为Bitmap
+     * cropRect为null时使用整帧，rotation为使裁剪区域摆正需顺时针旋转的角度(0/90/180/270)
+     * output尺寸需为裁剪并旋转后的尺寸，为null时不绘制文本框
+     */
+    fun detectYuv(image: Image, cropRect: Rect?, rotation: Int, output: Bitmap?, maxSideLen: Int): OcrResult {
+        require(image.format == ImageFormat.YUV_420_888)
+        val (yPlane, uPlane, vPlane) = image.planes
+        val crop = cropRect ?: Rect()
+        return detectYuv(
+            yPlane.buffer, uPlane.buffer, vPlane.buffer, image.width, image.height,
+            yPlane.rowStride, uPlane.rowStride, uPlane.pixelStride,
+            crop.left, crop.top, crop.width(), crop.height(), rotation, output, padding, maxSideLen,
+            boxScoreThresh, boxThresh,
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget
+        )
+    }
+
+    //同detectYuv，nv21为NV21格式(Camera1预览)的direct ByteBuffer
+    fun detectNv21(
+        nv21: ByteBuffer, width: Int, height: Int,
+        cropRect: Rect?, rotation: Int, output: Bitmap?, maxSideLen: Int
+    ): OcrResult {
+        require(nv21.isDirect)
+        val ySize = width * height
+        val vPlane = (nv21.duplicate().position(ySize) as ByteBuffer).slice()
+        val uPlane = (nv21.duplicate().position(ySize + 1) as ByteBuffer).slice()
+        val crop = cropRect ?: Rect()
+        return detectYuv(
+            nv21, uPlane, vPlane, width, height, width, width, 2,
+            crop.left, crop.top, crop.width(), crop.height(), rotation, output, padding, maxSideLen,
+            boxScoreThresh, boxThresh,
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget
+        )
+    }
+
+    /**
+     * 渐进式识别: 检测完成后立即回调文本框列表，之后逐个文本框裁剪、方向分类并识别，每识别完一行回调一次TextBlock，
+     * 最后仍返回完整结果。mostAngle=true时每行按已分类各行的多数方向旋转，不等待后面的文本行
+     * largestFirst=true时按文本框面积从大到小识别，否则按阅读顺序(从上到下、从左到右)
+     */
+    fun detectProgressive(
+        input: Bitmap, output: Bitmap?, maxSideLen: Int,
+        listener: OcrListener, largestFirst: Boolean = false
+    ) =
+        detectProgressive(
+            input, output, padding, maxSideLen,
+            boxScoreThresh, boxThresh,
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget, largestFirst, listener
+        )
+
+    /**
+     * 异步识别: 返回任务句柄，detectAsyncGet阻塞等待结果(每个句柄必须调用一次以释放)
+     * detectAsyncCancel可随时中断正在执行的模型推理并停止后续文本框处理，此时detectAsyncGet返回null
+     * timeout>0时超过该毫秒数后中断推理，返回已识别部分的结果(partial=true)
+     * drawBoxImg=false时不绘制文本框，detectAsyncGet的output可传null
+     */
+    fun detectAsync(input: Bitmap, maxSideLen: Int, timeout: Int = 0, drawBoxImg: Boolean = true): Long =
+        detectAsync(
+            input, padding, maxSideLen,
+            boxScoreThresh, boxThresh,
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget, timeout, drawBoxImg
         )
 
+    /**
+     * 流式识别: 检测与识别分两个线程流水执行，上一帧识别时下一帧已开始检测
+     * 用法: streamStart -> 多次streamPush/streamPop -> streamFinish -> streamPop直到返回null -> streamStop
+     * streamPop按push顺序返回结果，output尺寸需与对应帧的input一致
+     * drawBoxImg=false时不绘制文本框，streamPop的output可传null
+     * 各方法可在不同线程并发调用，streamStop/streamStart会让阻塞中的streamPush返回-1、streamPop返回null
+     */
+    fun streamPush(input: Bitmap, maxSideLen: Int, drawBoxImg: Boolean = true): Long =
+        streamPush(
+            input, padding, maxSideLen,
+            boxScoreThresh, boxThresh,
+            unClipRatio, doAngle, mostAngle, allowedChars,
+            textPattern, luhnCheck, latencyBudget, drawBoxImg
+        )
+
+    //释放native引擎，之后不可再调用，需确保没有正在进行的detect
+    fun release() = destroy()
+
+    private external fun create(): Long
+
+    private external fun destroy()
+
     external fun init(
         assetManager: AssetManager,
-        numThread: Int, detName: String,
+        numThread: Int, boxWorkers: Int, detName: String,
         clsName: String, recName: String, keysName: String
     ): Boolean
 
     external fun detect(
-        input: Bitmap, output: Bitmap, padding: Int, maxSideLen: Int,
+        input: Bitmap, output: Bitmap?, padding: Int, maxSideLen: Int,
         boxScoreThresh: Float, boxThresh: Float,
-        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean
+        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean,
+        allowedChars: String, textPattern: String, luhnCheck: Boolean,
+        latencyBudget: Double
     ): OcrResult
 
+    external fun detectFlat(
+        input: Bitmap, output: Bitmap?, padding: Int, maxSideLen: Int,
+        boxScoreThresh: Float, boxThresh: Float,
+        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean,
+        allowedChars: String, textPattern: String, luhnCheck: Boolean,
+        latencyBudget: Double
+    ): FlatOcrResult
+
+    external fun detectBinary(
+        input: Bitmap, buffer: ByteBuffer, padding: Int, maxSideLen: Int,
+        boxScoreThresh: Float, boxThresh: Float,
+        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean,
+        allowedChars: String, textPattern: String, luhnCheck: Boolean,
+        latencyBudget: Double
+    ): Int
+
+    external fun detectYuv(
+        yPlane: ByteBuffer, uPlane: ByteBuffer, vPlane: ByteBuffer,
+        width: Int, height: Int, yRowStride: Int, uvRowStride: Int, uvPixelStride: Int,
+        cropLeft: Int, cropTop: Int, cropWidth: Int, cropHeight: Int, rotation: Int,
+        output: Bitmap?, padding: Int, maxSideLen: Int,
+        boxScoreThresh: Float, boxThresh: Float,
+        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean,
+        allowedChars: String, textPattern: String, luhnCheck: Boolean,
+        latencyBudget: Double
+    ): OcrResult
+
+    external fun detectProgressive(
+        input: Bitmap, output: Bitmap?, padding: Int, maxSideLen: Int,
+        boxScoreThresh: Float, boxThresh: Float,
+        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean,
+        allowedChars: String, textPattern: String, luhnCheck: Boolean,
+        latencyBudget: Double, largestFirst: Boolean, listener: OcrListener
+    ): OcrResult
+
+    external fun detectAsync(
+        input: Bitmap, padding: Int, maxSideLen: Int,
+        boxScoreThresh: Float, boxThresh: Float,
+        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean,
+        allowedChars: String, textPattern: String, luhnCheck: Boolean,
+        latencyBudget: Double, timeout: Int, drawBoxImg: Boolean
+    ): Long
+
+    external fun detectAsyncCancel(handle: Long)
+
+    external fun detectAsyncGet(handle: Long, output: Bitmap?): OcrResult?
+
+    external fun streamStart(queueSize: Int)
+
+    external fun streamPush(
+        input: Bitmap, padding: Int, maxSideLen: Int,
+        boxScoreThresh: Float, boxThresh: Float,
+        unClipRatio: Float, doAngle: Boolean, mostAngle: Boolean,
+        allowedChars: String, textPattern: String, luhnCheck: Boolean,
+        latencyBudget: Double, drawBoxImg: Boolean
+    ): Long
+
+    external fun streamPop(output: Bitmap?): OcrResult?
+
+    external fun streamFinish()
+
+    external fun streamStop()
+
+    //[检测阶段占用率, 识别阶段占用率, 输入队列平均深度, 检测结果队列平均深度, 输出队列平均深度, 帧数, 帧率]
+    external fun streamStats(): DoubleArray
+
+    external fun setMaxRecWidth(width: Int)
+
+    external fun setRecCacheSize(size: Int)
+
+    external fun setRecWidthQuantum(quantum: Int)
+
+    //[取整前输入宽度种类数, 取整后输入宽度种类数]
+    external fun getRecShapeStats(): IntArray
+
+    external fun resetRecShapeStats()
+
+    //每个工作线程依次为[任务数, 窃取任务数, 忙碌时间ms, 占用率]，boxWorkers<=1时为空
+    external fun getBoxWorkerStats(): DoubleArray
+
+    external fun resetBoxWorkerStats()
+
+    /**
+     * 检测临时缓冲区[堆分配次数, 复用次数, 缓存字节数]，只统计workspace中的Mat与模型输入输出float缓冲区，
+     * 尺寸稳定的视频流中这部分分配次数不再增长。文本框轮廓、裁剪结果与文本等仍每帧在堆上分配，
+     * ORT也会分配输出张量，setMemoryProbe后由OcrResult.memoryStats的帧堆增长可看到每次调用剩余的堆占用
+     */
+    external fun getWorkspaceStats(): LongArray
+
+    //OcrResult.memoryStats中记录各模型推理期间的堆增长(ORT内存池扩张)和整个调用前后的堆增长，每次推理多一次mallinfo
+    external fun setMemoryProbe(enabled: Boolean)
+
+    //接下来runs次推理中各模型改用开启ORT profiling的会话(需重新加载模型)，结果文件写入dir(如context.cacheDir)
+    external fun startProfiling(dir: String, runs: Int): Boolean
+
+    //各模型按算子类型汇总的耗时前topK名，来自最近一次完成的profiling
+    external fun getProfileSummary(topK: Int): String
+
+    //记录各阶段与各文本框任务的耗时区间(含线程ID)，进程内所有引擎共用，最多保留最近65536个
+    external fun startTrace()
+
+    external fun stopTrace()
+
+    //Chrome trace JSON，保存为.json后可在ui.perfetto.dev或chrome://tracing中打开
+    external fun getTrace(): String
+
     external fun benchmark(input: Bitmap, loop: Int): Double
 
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+package com.benjaminwan.ocrlibrary
+
+/**
+ * 渐进式识别回调，在调用detectProgressive的线程上执行
+ */
+interface OcrListener {
+    //文本框检测完成后立即回调(尚未裁剪)，坐标为原图坐标
+    fun onTextBoxes(textBoxes: ArrayList<TextBox>)
+
+    //单个文本行识别完成，index为onTextBoxes中文本框的下标，超出耗时预算的文本框不回调
+    fun onTextBlock(index: Int, textBlock: TextBlock)
+}
@@ -13,14 +13,25 @@ object OcrFailed : OcrOutput()
 data class OcrResult(
     val dbNetTime: Double,
     val textBlocks: ArrayList<TextBlock>,
-    var boxImg: Bitmap,
+    var boxImg: Bitmap?,
     var detectTime: Double,
-    var strRes: String
+    var strRes: String,
+    val cacheHits: Int,
+    val cacheMisses: Int,
+    val partial: Boolean,
+    val skippedBoxes: ArrayList<TextBox>,
+    //字节数[detectPeak, cropPeak, recognizePeak, largestMat, dbNetHeapGrowth, angleNetHeapGrowth,
+    //crnnNetHeapGrowth, frameHeapGrowth]，即各阶段峰值、最大单个Mat、各模型推理期间进程堆的增长(并非模型占用的字节数)
+    //与帧堆增长，后四项需setMemoryProbe；帧堆增长为调用结束时与开始时进程堆占用之差，并发调用时相互叠加
+    val memoryStats: LongArray = LongArray(0)
 ) : Parcelable, OcrOutput()
 
 @Parcelize
 data class Point(var x: Int, var y: Int) : Parcelable
 
+@Parcelize
+data class TextBox(val boxPoint: ArrayList<Point>, val score: Float) : Parcelable
+
 @Parcelize
 data class TextBlock(
     val boxPoint: ArrayList<Point>, var boxScore: Float,
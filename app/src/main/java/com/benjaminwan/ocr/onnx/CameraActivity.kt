@@ -35,6 +35,7 @@ class CameraActivity : AppCompatActivity(), View.OnClickListener, SeekBar.OnSeek
     private var imageCapture: ImageCapture? = null
     private var camera: Camera? = null
     private var detectJob: Job? = null
+    private var detectHandle: Long = 0
 
     private fun initViews() {
         binding.clearBtn.setOnClickListener(this)
@@ -60,6 +61,9 @@ class CameraActivity : AppCompatActivity(), View.OnClickListener, SeekBar.OnSeek
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
         App.ocrEngine.doAngle = false//摄像头一般不需要考虑倒过来的情况
+        App.ocrEngine.allowedChars = ""
+        App.ocrEngine.textPattern = ""
+        App.ocrEngine.luhnCheck = false
         binding = ActivityCameraBinding.inflate(layoutInflater)
         setContentView(binding.root)
         initViews()
@@ -108,6 +112,8 @@ class CameraActivity : AppCompatActivity(), View.OnClickListener, SeekBar.OnSeek
                 detectJob = detect(maxSideLen)
             }
             R.id.stopBtn -> {
+                //协程取消无法打断native推理，需同时取消native任务
+                App.ocrEngine.detectAsyncCancel(detectHandle)
                 detectJob?.cancel()
                 clearLastResult()
             }
@@ -210,12 +216,14 @@ class CameraActivity : AppCompatActivity(), View.OnClickListener, SeekBar.OnSeek
     private fun detect(reSize: Int) = flow {
         emit(binding.cameraLensView.cropCameraLensRectBitmap(binding.viewFinder.bitmap, false))
     }.flowOn(Dispatchers.Main)
-        .map { src ->
+        .mapNotNull { src ->
             val boxImg: Bitmap = Bitmap.createBitmap(
                 src.width, src.height, Bitmap.Config.ARGB_8888
             )
             Logger.i("selectedImg=${src.height},${src.width} ${src.config}")
-            App.ocrEngine.detect(src, boxImg, reSize)
+            val handle = App.ocrEngine.detectAsync(src, reSize)
+            detectHandle = handle
+            App.ocrEngine.detectAsyncGet(handle, boxImg)
         }
         .flowOn(Dispatchers.IO)
         .onStart {
@@ -70,6 +70,9 @@ class GalleryActivity : AppCompatActivity(), View.OnClickListener, SeekBar.OnSee
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
         App.ocrEngine.doAngle = true//相册识别时，默认启用文字方向检测
+        App.ocrEngine.allowedChars = ""
+        App.ocrEngine.textPattern = ""
+        App.ocrEngine.luhnCheck = false
         binding = ActivityGalleryBinding.inflate(layoutInflater)
         setContentView(binding.root)
         initViews()
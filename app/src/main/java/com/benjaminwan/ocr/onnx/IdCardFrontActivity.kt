@@ -77,6 +77,9 @@ class IdCardFrontActivity : AppCompatActivity(), View.OnClickListener {
         App.ocrEngine.padding = 200
         App.ocrEngine.boxScoreThresh = 0.1f
         App.ocrEngine.unClipRatio = 2.0f
+        App.ocrEngine.allowedChars = ""
+        App.ocrEngine.textPattern = ""
+        App.ocrEngine.luhnCheck = false
         binding = ActivityIdcardFrontBinding.inflate(layoutInflater)
         setContentView(binding.root)
         initViews()
@@ -178,9 +181,8 @@ class IdCardFrontActivity : AppCompatActivity(), View.OnClickListener {
 
     private fun detectOnce(bitmap: Bitmap): OcrResult {
         val maxSize = max(bitmap.height, bitmap.width)
-        val boxImg = Bitmap.createBitmap(bitmap.width, bitmap.height, Bitmap.Config.ARGB_8888)
         App.ocrEngine.padding = maxSize / 10
-        return App.ocrEngine.detect(bitmap, boxImg, maxSize)
+        return App.ocrEngine.detect(bitmap, null, maxSize)
     }
 
     private fun setDetectState(isStart: Boolean) {
@@ -19,6 +19,8 @@ import com.afollestad.assent.rationale.createDialogRationale
 import com.benjaminwan.ocr.onnx.app.App
 import com.benjaminwan.ocr.onnx.databinding.ActivityImeiBinding
 import com.benjaminwan.ocr.onnx.utils.getMatchImeiStr
+import com.benjaminwan.ocr.onnx.utils.imeiChars
+import com.benjaminwan.ocr.onnx.utils.imeiPattern
 import com.benjaminwan.ocr.onnx.utils.replaceBlank
 import com.benjaminwan.ocr.onnx.utils.showToast
 import com.benjaminwan.ocrlibrary.OcrFailed
@@ -66,6 +68,9 @@ class ImeiActivity : AppCompatActivity(), View.OnClickListener {
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
         App.ocrEngine.doAngle = false//摄像头拍摄一般都是正的，不需要判断方向
+        App.ocrEngine.allowedChars = imeiChars//IMEI只包含数字和标签
+        App.ocrEngine.textPattern = imeiPattern
+        App.ocrEngine.luhnCheck = true
         binding = ActivityImeiBinding.inflate(layoutInflater)
         setContentView(binding.root)
         initViews()
@@ -19,6 +19,8 @@ import com.afollestad.assent.rationale.createDialogRationale
 import com.benjaminwan.ocr.onnx.app.App
 import com.benjaminwan.ocr.onnx.databinding.ActivityPlateBinding
 import com.benjaminwan.ocr.onnx.utils.getMatchPlateStr
+import com.benjaminwan.ocr.onnx.utils.plateChars
+import com.benjaminwan.ocr.onnx.utils.plateRegex
 import com.benjaminwan.ocr.onnx.utils.showToast
 import com.benjaminwan.ocr.onnx.utils.trimBlankAndSymbols
 import com.benjaminwan.ocrlibrary.OcrFailed
@@ -69,6 +71,9 @@ class PlateActivity : AppCompatActivity(), View.OnClickListener {
         App.ocrEngine.padding = 100
         App.ocrEngine.boxScoreThresh = 0.2f
         App.ocrEngine.unClipRatio = 2.0f
+        App.ocrEngine.allowedChars = plateChars//只输出车牌可能出现的字符
+        App.ocrEngine.textPattern = plateRegex
+        App.ocrEngine.luhnCheck = false
         binding = ActivityPlateBinding.inflate(layoutInflater)
         setContentView(binding.root)
         initViews()
@@ -4,10 +4,23 @@ import com.orhanobut.logger.Logger
 import java.util.regex.Matcher
 import java.util.regex.Pattern
 
-const val imeiRegex = "\\d{15}|\\d{17}"
+//17位在前，避免IMEISV只匹配到前15位
+const val imeiRegex = "\\d{17}|\\d{15}"
+
+//IMEI识别时允许输出的字符，含标签"IMEI:"、"IMEISV:"及标签中的空格(与imeiPattern中的\s对应)
+const val imeiChars = "0123456789IMESV:： "
+
+//IMEI约束解码: 可带标签，15位IMEI(需通过Luhn校验)或17位IMEISV
+const val imeiPattern = "(IMEI(SV)?\\s?\\d?\\s?[:：]?\\s?)?(\\d{15}|\\d{17})"
+
+//识别结果中的标签，如"IMEI:"、"IMEI 1："、"IMEISV:"，卡槽序号只在后跟冒号时属于标签
+private val imeiLabelRegex = Regex("IMEI(SV)?(\\s?\\d?\\s?[:：])?")
 
 fun getMatchImeiStr(text: String): String? {
-    val matchALL = Regex(imeiRegex).find(text)
+    //约束解码无匹配时回退为贪心解码，字母可能被误识别混入数字中:
+    //去掉标签后其余非数字字符都作为分隔，只在纯数字中查找
+    val digits = text.replace(imeiLabelRegex, " ").replace(Regex("\\D+"), " ")
+    val matchALL = Regex(imeiRegex).find(digits)
     if (matchALL != null) {
         Logger.i("match结果 matchALL:${matchALL.value}")
         return matchALL.value
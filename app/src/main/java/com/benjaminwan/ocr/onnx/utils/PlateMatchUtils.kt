@@ -6,6 +6,10 @@ import java.util.regex.Pattern
 
 const val plateRegex = "^(([京津沪渝冀豫云辽黑湘皖鲁新苏浙赣鄂桂甘晋蒙陕吉闽贵粤青藏川宁琼使领][A-Z](([0-9]{5}[DF])|([DF]([A-HJ-NP-Z0-9])[0-9]{4})))|([京津沪渝冀豫云辽黑湘皖鲁新苏浙赣鄂桂甘晋蒙陕吉闽贵粤青藏川宁琼使领][A-Z][A-HJ-NP-Z0-9]{4}[A-HJ-NP-Z0-9挂学警港澳使领]))\$"
 
+//车牌识别时允许输出的字符: 省份简称、字母、数字及特殊后缀
+const val plateChars =
+    "京津沪渝冀豫云辽黑湘皖鲁新苏浙赣鄂桂甘晋蒙陕吉闽贵粤青藏川宁琼使领挂学警港澳ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+
 fun getMatchPlateStr(text: String): String? {
     val matchALL = Regex(plateRegex).find(text)
     if (matchALL != null) {